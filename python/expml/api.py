@@ -9,7 +9,7 @@ from .monitor import SystemMonitor
 _CURRENT_RUN = None
 
 class ActiveRun:
-    def __init__(self, config=None, name=None):
+    def __init__(self, config=None, name=None, metrics_format="jsonl"):
         self.id = str(uuid.uuid4())[:8]
         self.name = name or f"run-{self.id}"
         self.step = 0
@@ -27,7 +27,7 @@ class ActiveRun:
         os.symlink(self.name, symlink)
 
         # Initialize Components
-        self.writer = RunWriter(self.run_dir)
+        self.writer = RunWriter(self.run_dir, metrics_format=metrics_format)
         self.monitor = SystemMonitor(self.writer)
 
         # Write Static Files
@@ -67,6 +67,7 @@ class ActiveRun:
 
     def finish(self):
         self.monitor.stop()
+        self.writer.flush_manifest()
         
         self.writer.update_summary({
             "status": "FINISHED",
@@ -76,12 +77,12 @@ class ActiveRun:
 
 # --- Public API Functions ---
 
-def init(config=None, name=None, project=None):
+def init(config=None, name=None, project=None, metrics_format="jsonl"):
     global _CURRENT_RUN
     if _CURRENT_RUN:
         print("Warning: Run already active. Finishing previous run.")
         finish()
-    _CURRENT_RUN = ActiveRun(config=config, name=name)
+    _CURRENT_RUN = ActiveRun(config=config, name=name, metrics_format=metrics_format)
 
 def log(metrics):
     if _CURRENT_RUN:
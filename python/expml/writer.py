@@ -1,13 +1,81 @@
 import json
+import math
 import os
+import struct
+import threading
 import time
 
+# Binary metrics layout (metrics.expb, little-endian):
+#   file header: b"EXPB" + u32 version
+#   record:      u8 type, 3 pad bytes, u32 payload length, payload, u32 commit marker
+#   'K' payload: new key definitions, repeated (u32 key_id, u16 name_len, utf-8 name)
+#   'R' payload: one row, repeated (u32 key_id, f64 value)
+# A record only counts once its commit marker is on disk, so readers tailing the
+# file skip a half-written record until the rest of it arrives.
+BINARY_MAGIC = b"EXPB"
+BINARY_VERSION = 1
+RECORD_KEYS = ord("K")
+RECORD_ROW = ord("R")
+COMMIT_MARKER = 0x54494D43  # b"CMIT"
+
+# Key manifest (keys.json): every charted key in order of first appearance, with running
+# stats over the first 'covered_offset' bytes of each metrics stream, so a reader can lay
+# out charts and ranges before it parses any rows. Rewritten atomically when a key first
+# appears and otherwise at most every MANIFEST_INTERVAL seconds, so it may lag a little
+KEYS_MANIFEST_VERSION = 2
+MANIFEST_INTERVAL = 1.0
+
+# Namespace streams: keys named "<namespace>/..." for these namespaces are logged to their
+# own metrics.<namespace>.jsonl (or .expb) instead of the main metrics file, each row
+# repeating the bookkeeping fields ("_step", "_timestamp", ...). streams.json lists the
+# streams in the order they were created, so a reader can tail only the ones it shows
+SHARDED_NAMESPACES = ("system", "grad", "weight")
+STREAMS_MANIFEST_VERSION = 1
+
+_RECORD_HEADER = struct.Struct("<BxxxI")
+_COMMIT = struct.Struct("<I").pack(COMMIT_MARKER)
+_KEY_ENTRY = struct.Struct("<IH")
+
+class _MetricsStream:
+    # One metrics file and the append state that goes with it. 'name' is the namespace,
+    # or "" for the main metrics file
+    def __init__(self, run_dir, name, binary):
+        base = f"metrics.{name}" if name else "metrics"
+        self.name = name
+        self.binary = binary
+        self.path = os.path.join(run_dir, base + (".expb" if binary else ".jsonl"))
+        self.key_ids = {}
+        if binary:
+            with open(self.path, "wb") as f:
+                f.write(BINARY_MAGIC + struct.pack("<I", BINARY_VERSION))
+        self.offset = os.path.getsize(self.path) if os.path.exists(self.path) else 0
+
 class RunWriter:
-    def __init__(self, run_dir):
+    def __init__(self, run_dir, metrics_format="jsonl", sharded_namespaces=SHARDED_NAMESPACES):
+        if metrics_format not in ("jsonl", "binary"):
+            raise ValueError(f"unknown metrics_format: {metrics_format!r}")
         self.run_dir = run_dir
-        self.metrics_path = os.path.join(run_dir, "metrics.jsonl")
+        self.metrics_format = metrics_format
         self.summary_path = os.path.join(run_dir, "summary.json")
         self.summary_cache = {}
+        self.manifest_path = os.path.join(run_dir, "keys.json")
+        self.streams_path = os.path.join(run_dir, "streams.json")
+
+        # Namespaces end up in file names, so only plain ones can have a stream
+        self.sharded_namespaces = {ns for ns in sharded_namespaces
+                                   if ns and all(c.isalnum() or c in "_-" for c in ns)}
+
+        # Shared by the training loop and the system monitor thread
+        self._lock = threading.Lock()
+        self._key_stats = {}  # key -> [first_step, last_step, count, min, max, last, first_offset, stream]
+        self._manifest_time = 0.0
+        self._manifest_dirty = False
+
+        # Namespace streams are created when their first key is logged
+        self._main = _MetricsStream(run_dir, "", metrics_format == "binary")
+        self._streams = [self._main]
+        self._stream_by_name = {"": self._main}
+        self.metrics_path = self._main.path
 
     def write_config(self, config):
         path = os.path.join(self.run_dir, "config.json")
@@ -20,9 +88,151 @@ class RunWriter:
             json.dump(metadata, f, indent=2)
 
     def log_metrics(self, data):
-        # atomic append
-        with open(self.metrics_path, "a") as f:
-            f.write(json.dumps(data) + "\n")
+        with self._lock:
+            for stream, row in self._split_row(data):
+                if stream.binary:
+                    record = self._encode_binary(stream, row)
+                else:
+                    record = (json.dumps(row) + "\n").encode("utf-8")
+                # atomic append
+                with open(stream.path, "ab") as f:
+                    f.write(record)
+                self._track_keys(row, stream, stream.offset)
+                stream.offset += len(record)
+            self._maybe_write_manifest()
+
+    def _split_row(self, data):
+        # Cuts a row into one row per stream it has keys for. Bookkeeping fields go into
+        # every part; a row with nothing for a namespace stream stays whole in the main file.
+        # Caller holds the lock
+        common = {}
+        parts = {}
+        for key, value in data.items():
+            if key.startswith("_"):
+                common[key] = value
+                continue
+            namespace = key.split("/", 1)[0] if "/" in key else ""
+            if namespace not in self.sharded_namespaces:
+                namespace = ""
+            parts.setdefault(namespace, {})[key] = value
+        if not parts:
+            parts[""] = {}
+
+        return [(self._get_stream(name), {**common, **fields}) for name, fields in parts.items()]
+
+    def _get_stream(self, name):
+        # Caller holds the lock
+        stream = self._stream_by_name.get(name)
+        if stream is None:
+            stream = _MetricsStream(self.run_dir, name, self.metrics_format == "binary")
+            self._streams.append(stream)
+            self._stream_by_name[name] = stream
+            # The file exists before any reader is told about it
+            if not stream.binary:
+                open(stream.path, "ab").close()
+            self._write_streams()
+        return stream
+
+    def _write_streams(self):
+        # Caller holds the lock. Atomic, like the key manifest
+        manifest = {
+            "version": STREAMS_MANIFEST_VERSION,
+            "streams": [s.name for s in self._streams if s.name],
+        }
+        tmp_path = self.streams_path + ".tmp"
+        with open(tmp_path, "w") as f:
+            json.dump(manifest, f)
+        os.replace(tmp_path, self.streams_path)
+
+    def _encode_binary(self, stream, data):
+        # Only numbers fit the (key_id, f64) row; bools and strings are left out.
+        # Caller holds the lock
+        items = [(k, v) for k, v in data.items()
+                 if isinstance(v, (int, float)) and not isinstance(v, bool)]
+
+        new_keys = []
+        row = []
+        for key, value in items:
+            key_id = stream.key_ids.get(key)
+            if key_id is None:
+                key_id = len(stream.key_ids)
+                stream.key_ids[key] = key_id
+                new_keys.append((key_id, key.encode("utf-8")))
+            row.append(key_id)
+            row.append(float(value))
+
+        chunks = []
+        if new_keys:
+            keys = b"".join(_KEY_ENTRY.pack(i, len(name)) + name for i, name in new_keys)
+            chunks += [_RECORD_HEADER.pack(RECORD_KEYS, len(keys)), keys, _COMMIT]
+        payload = struct.pack("<" + "Id" * len(items), *row)
+        chunks += [_RECORD_HEADER.pack(RECORD_ROW, len(payload)), payload, _COMMIT]
+
+        # Key definitions land before the row that first uses them, in one append
+        return b"".join(chunks)
+
+    def _track_keys(self, data, stream, offset):
+        # Folds one row into the per-key stats; 'offset' is where the row starts in the
+        # stream's file. Caller holds the lock
+        step = data.get("_step", -1)
+        for key, value in data.items():
+            # Bookkeeping fields ("_step", "_runtime", ...) are never charted
+            if key.startswith("_") or not isinstance(value, (int, float)) or isinstance(value, bool):
+                continue
+            value = float(value)
+            stats = self._key_stats.get(key)
+            if stats is None:
+                stats = [step, step, 0, None, None, None, offset, stream.name]
+                self._key_stats[key] = stats
+                # A new key changes the layout: let readers see it on the next write
+                self._manifest_time = 0.0
+            if step < stats[0]:
+                stats[0] = step
+            if step > stats[1]:
+                stats[1] = step
+            stats[2] += 1
+            if math.isfinite(value):
+                if stats[3] is None or value < stats[3]:
+                    stats[3] = value
+                if stats[4] is None or value > stats[4]:
+                    stats[4] = value
+                stats[5] = value
+            else:
+                stats[5] = None
+        self._manifest_dirty = True
+
+    def _maybe_write_manifest(self):
+        # Caller holds the lock
+        now = time.monotonic()
+        if now - self._manifest_time >= MANIFEST_INTERVAL:
+            self._write_manifest()
+            self._manifest_time = now
+
+    def _write_manifest(self):
+        # Caller holds the lock. Written to a temporary file and renamed into place, so a
+        # reader never sees half of it
+        if not self._manifest_dirty:
+            return
+        keys = [{"name": key, "stream": s[7], "first_step": s[0], "last_step": s[1], "count": s[2],
+                 "min": s[3], "max": s[4], "last": s[5], "first_offset": s[6]}
+                for key, s in self._key_stats.items()]
+        streams = [{"name": s.name, "file": os.path.basename(s.path), "covered_offset": s.offset}
+                   for s in self._streams]
+        manifest = {
+            "version": KEYS_MANIFEST_VERSION,
+            "streams": streams,
+            "keys": keys,
+        }
+        tmp_path = self.manifest_path + ".tmp"
+        with open(tmp_path, "w") as f:
+            json.dump(manifest, f, allow_nan=False)
+        os.replace(tmp_path, self.manifest_path)
+        self._manifest_dirty = False
+
+    def flush_manifest(self):
+        # Brings keys.json up to date with everything logged so far
+        with self._lock:
+            self._write_manifest()
 
     def update_summary(self, data):
         self.summary_cache.update(data)
@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "Arena.h"
+
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+#define ARENA_MAX_BLOCK (1 << 20)   // Doubling stops here; bigger requests get a block of their own
+
+// One heap block; allocations are bumped out of 'data'
+typedef struct ArenaBlock_ {
+    struct ArenaBlock_* next;  // The block allocated before this one
+    size_t size;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+} ArenaBlock;
+
+struct Arena_ {
+    ArenaBlock* blocks;        // Newest block first; the last one is the first allocated
+    size_t block_size;         // Size of the next block to allocate
+    size_t first_size;
+    ArenaStats stats;
+    ArenaStats folded;         // Part of 'stats' already added to the totals
+};
+
+static _Atomic uint64_t totalAllocations;
+static _Atomic uint64_t totalBytes;
+static _Atomic uint64_t totalBlocks;
+
+static _Thread_local Arena* jsonArena;
+static pthread_once_t jsonHooksOnce = PTHREAD_ONCE_INIT;
+
+// Creates an empty arena whose first block will hold 'block_size' bytes; later blocks
+// double in size. Returns NULL on allocation failure
+Arena* Arena_new(size_t block_size) {
+    Arena* this = calloc(1, sizeof(Arena));
+    if (!this) return NULL;
+    this->first_size = block_size < 256 ? 256 : block_size;
+    this->block_size = this->first_size;
+    return this;
+}
+
+// Adds what the arena served since the last fold to the process-wide totals
+static void foldStats(Arena* this) {
+    atomic_fetch_add_explicit(&totalAllocations, this->stats.allocations - this->folded.allocations, memory_order_relaxed);
+    atomic_fetch_add_explicit(&totalBytes, this->stats.bytes - this->folded.bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&totalBlocks, this->stats.blocks - this->folded.blocks, memory_order_relaxed);
+    this->folded = this->stats;
+}
+
+// Frees the arena and everything allocated from it
+void Arena_delete(Arena* this) {
+    if (!this) return;
+    foldStats(this);
+    for (ArenaBlock* b = this->blocks; b;) {
+        ArenaBlock* next = b->next;
+        free(b);
+        b = next;
+    }
+    free(this);
+}
+
+// Returns 'size' bytes aligned for any type, or NULL on allocation failure
+void* Arena_alloc(Arena* this, size_t size) {
+    if (!this) return NULL;
+    size_t rounded = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (rounded < size) return NULL;
+
+    ArenaBlock* b = this->blocks;
+    if (!b || b->size - b->used < rounded) {
+        size_t block_size = this->block_size;
+        if (block_size < rounded) block_size = rounded;
+        if (block_size > SIZE_MAX - sizeof(ArenaBlock)) return NULL;
+
+        b = malloc(sizeof(ArenaBlock) + block_size);
+        if (!b) return NULL;
+        b->size = block_size;
+        b->used = 0;
+        b->next = this->blocks;
+        this->blocks = b;
+        this->stats.blocks++;
+        if (this->block_size < ARENA_MAX_BLOCK) this->block_size *= 2;
+    }
+
+    void* p = b->data + b->used;
+    b->used += rounded;
+    this->stats.allocations++;
+    this->stats.bytes += size;
+    return p;
+}
+
+// Copies a string into the arena. NULL on allocation failure
+char* Arena_strdup(Arena* this, const char* s) {
+    if (!s) return NULL;
+    size_t len = strlen(s) + 1;
+    char* copy = Arena_alloc(this, len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+// Releases everything allocated so far, keeping the first block for reuse
+void Arena_reset(Arena* this) {
+    if (!this || !this->blocks) return;
+    foldStats(this);
+
+    // Keep the oldest block, which is the one a reset arena would allocate again
+    ArenaBlock* b = this->blocks;
+    while (b->next) {
+        ArenaBlock* next = b->next;
+        free(b);
+        b = next;
+    }
+    b->used = 0;
+    this->blocks = b;
+    this->block_size = this->first_size * 2;
+}
+
+// Returns the counts of an arena since it was created
+ArenaStats Arena_getStats(const Arena* this) {
+    ArenaStats stats;
+    memset(&stats, 0, sizeof(stats));
+    return this ? this->stats : stats;
+}
+
+// Returns the counts of every arena, as of each one's last reset or deletion
+ArenaStats Arena_getTotals(void) {
+    ArenaStats stats;
+    stats.allocations = atomic_load_explicit(&totalAllocations, memory_order_relaxed);
+    stats.bytes = atomic_load_explicit(&totalBytes, memory_order_relaxed);
+    stats.blocks = atomic_load_explicit(&totalBlocks, memory_order_relaxed);
+    return stats;
+}
+
+// Returns true if 'p' was allocated from the arena
+static bool arenaOwns(const Arena* this, const void* p) {
+    for (const ArenaBlock* b = this->blocks; b; b = b->next) {
+        if ((const unsigned char*)p >= b->data && (const unsigned char*)p < b->data + b->size) return true;
+    }
+    return false;
+}
+
+// cJSON allocation hook: the calling thread's arena if it has one, else the heap
+static void* jsonAllocate(size_t size) {
+    return jsonArena ? Arena_alloc(jsonArena, size) : malloc(size);
+}
+
+// cJSON free hook: arena memory goes when its arena does (a failed parse frees its partial
+// tree here); anything else came from the heap
+static void jsonDeallocate(void* p) {
+    if (jsonArena && arenaOwns(jsonArena, p)) return;
+    free(p);
+}
+
+static void installJsonHooks(void) {
+    cJSON_Hooks hooks = { jsonAllocate, jsonDeallocate };
+    cJSON_InitHooks(&hooks);
+}
+
+// Points cJSON's allocator hooks at arenas. Call once at startup, before any thread
+// uses cJSON; until Arena_useForJson routes a thread elsewhere, cJSON uses the heap as usual
+void Arena_installJsonHooks(void) {
+    pthread_once(&jsonHooksOnce, installJsonHooks);
+}
+
+// Makes cJSON allocate from 'arena' on the calling thread (NULL: the heap again) and returns
+// the arena used before. Trees parsed meanwhile live in the arena: release them with it,
+// never with cJSON_Delete
+Arena* Arena_useForJson(Arena* arena) {
+    // A thread that got here first still must not build arena trees with heap hooks
+    Arena_installJsonHooks();
+    Arena* previous = jsonArena;
+    jsonArena = arena;
+    return previous;
+}
@@ -0,0 +1,50 @@
+#ifndef EXPML_ARENA_H
+#define EXPML_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A bump allocator for short-lived objects that die together: allocations are carved out
+// of a few large blocks and never freed one by one; resetting or deleting the arena
+// releases all of them at once. An arena is not thread-safe; each thread uses its own
+typedef struct Arena_ Arena;
+
+// Allocation counts, for checking how much heap traffic arenas absorb
+typedef struct ArenaStats_ {
+    uint64_t allocations;  // Requests served
+    uint64_t bytes;        // Bytes handed out
+    uint64_t blocks;       // Blocks taken from the heap to serve them
+} ArenaStats;
+
+// Creates an empty arena whose first block will hold 'block_size' bytes; later blocks
+// double in size. Returns NULL on allocation failure
+Arena* Arena_new(size_t block_size);
+
+// Frees the arena and everything allocated from it
+void Arena_delete(Arena* this);
+
+// Returns 'size' bytes aligned for any type, or NULL on allocation failure
+void* Arena_alloc(Arena* this, size_t size);
+
+// Copies a string into the arena. NULL on allocation failure
+char* Arena_strdup(Arena* this, const char* s);
+
+// Releases everything allocated so far, keeping the first block for reuse
+void Arena_reset(Arena* this);
+
+// Returns the counts of an arena since it was created
+ArenaStats Arena_getStats(const Arena* this);
+
+// Returns the counts of every arena, as of each one's last reset or deletion
+ArenaStats Arena_getTotals(void);
+
+// Points cJSON's allocator hooks at arenas. Call once at startup, before any thread
+// uses cJSON; until Arena_useForJson routes a thread elsewhere, cJSON uses the heap as usual
+void Arena_installJsonHooks(void);
+
+// Makes cJSON allocate from 'arena' on the calling thread (NULL: the heap again) and returns
+// the arena used before. Trees parsed meanwhile live in the arena: release them with it,
+// never with cJSON_Delete
+Arena* Arena_useForJson(Arena* arena);
+
+#endif
@@ -3,12 +3,15 @@
 #include "LogViewer.h"
 #include "Storage.h"
 
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-extern void runTUI(const char* expml_dir);
+extern void runTUI(const char* expml_dir, int64_t window, size_t max_memory);
 #define VERSION "0.1.0"
 #define PROGRAM_NAME "expml"
 
@@ -28,6 +31,21 @@ static void printHelpFlag(void) {
    printf("  logs       View experiment logs\n");
 }
 
+// Prints help for run command
+static void printRunHelp(void) {
+    printf("Usage: %s run [OPTIONS]\n\n", PROGRAM_NAME);
+    printf("Watch the latest experiment run.\n\n");
+    printf("Options:\n");
+    printf("  -p, --path PATH    Directory holding latest-run (default: expml_runs)\n");
+    printf("  -w, --window N     Keep only the last N steps of each metric in memory;\n");
+    printf("                     older points are summarized as min/max/mean\n");
+    printf("  -m, --max-memory SIZE\n");
+    printf("                     Cap the memory metrics take up (e.g. 512M, 2G); the\n");
+    printf("                     oldest points of the largest metrics are downsampled\n");
+    printf("                     to min/max pairs to stay within it\n");
+    printf("  -h, --help         Show this help message\n");
+}
+
 // Prints help for logs command
 static void printLogsHelp(void) {
     printf("Usage: %s logs [OPTIONS]\n\n", PROGRAM_NAME);
@@ -54,6 +72,85 @@ static int parseLogLevel(const char* level_str) {
     return -1; // Invalid level
 }
 
+// Parses a byte count with an optional K, M, G or T suffix (powers of 1024, optionally
+// followed by B or iB). Returns false for anything else, or for zero
+static bool parseSize(const char* text, size_t* bytes) {
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || !(value > 0)) return false;
+
+    double scale = 1;
+    const char* units = "KMGT";
+    const char* unit = *end ? strchr(units, toupper((unsigned char)*end)) : NULL;
+    if (unit) {
+        for (const char* u = units; u <= unit; u++) scale *= 1024;
+        end++;
+        if (*end == 'i') end++;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0' || value * scale >= (double)SIZE_MAX) return false;
+
+    *bytes = (size_t)(value * scale);
+    return *bytes > 0;
+}
+
+// Handles the run command
+static CommandStatus handleRunCommand(int argc, char** argv) {
+    const char* expml_dir = "expml_runs";
+    int64_t window = 0; // Whole history by default
+    size_t max_memory = 0; // No memory limit by default
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printRunHelp();
+            return CMD_EXIT;
+        }
+        else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--path") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires a path argument.\n", argv[i]);
+                return CMD_ERROR;
+            }
+            expml_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--window") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires a number argument.\n", argv[i]);
+                return CMD_ERROR;
+            }
+            char* end;
+            window = strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || window <= 0) {
+                fprintf(stderr, "Error: window must be a positive number of steps.\n");
+                return CMD_ERROR;
+            }
+        }
+        else if (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--max-memory") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires a size argument.\n", argv[i]);
+                return CMD_ERROR;
+            }
+            if (!parseSize(argv[++i], &max_memory)) {
+                fprintf(stderr, "Error: max memory must be a size such as 512M or 2G.\n");
+                return CMD_ERROR;
+            }
+        }
+        else {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[i]);
+            fprintf(stderr, "Try '%s run --help' for usage.\n", PROGRAM_NAME);
+            return CMD_ERROR;
+        }
+    }
+
+    // A window already bounds memory, and its summary of dropped points needs them all
+    if (window > 0 && max_memory > 0) {
+        fprintf(stderr, "Error: --window and --max-memory cannot be combined.\n");
+        return CMD_ERROR;
+    }
+
+    runTUI(expml_dir, window, max_memory);
+    return CMD_SUCCESS;
+}
+
 // Handles the logs command
 static CommandStatus handleLogsCommand(int argc, char** argv) {
     const char* run_path = NULL;
@@ -152,13 +249,7 @@ static CommandStatus parseCommand(int argc, char** argv) {
    if (strcmp(command, "--help") == 0)    { printHelpFlag();    return CMD_EXIT; }
    
    if (strcmp(command, "run") == 0) {
-      const char* expml_dir = "expml_runs";
-      if (argc > 2 && strcmp(argv[2], "-p") == 0) {
-         if (argc < 4) { fprintf(stderr, "Error: -p requires a path argument.\n"); return CMD_ERROR; }
-         expml_dir = argv[3];
-      }  
-      runTUI(expml_dir);
-      return CMD_SUCCESS;
+      return handleRunCommand(argc, argv);
    }
    
    if (strcmp(command, "logs") == 0) {
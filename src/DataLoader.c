@@ -1,159 +1,1559 @@
 #include "Storage.h"
+#include "KeyTable.h"
+#include "MetricStore.h"
+#include "JsonScan.h"
+#include "Log.h"
 #include "DataLoader.h"
 #include "SystemPanel.h"
 #include "MetricsPanel.h"
 
 #include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <cjson/cJSON.h>
+#include <unistd.h>
 
-#define METRIC_INITIAL_CAPACITY 1024
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
+#define PARALLEL_MIN_BYTES (8 << 20)   // Slices smaller than this are parsed on the loader thread alone
+#define PARALLEL_MAX_WORKERS 8
+#define PROGRESSIVE_MIN_BYTES (1 << 20)  // Backlogs at least this big are loaded newest rows first
+#define TAIL_FIRST_BYTES (256 << 10)     // Size of the first slice of a progressive load
+
+// How a stream treats the points of one key. A key is settled when the stream first meets
+// it: stored in full, or, once the UI has said which cards are on screen and this is not
+// one of them, only tallied
+typedef enum {
+    KEY_UNSEEN,               // Not met in this stream yet
+    KEY_STORED,               // Every point read is in the key's series
+    KEY_TALLIED,              // Only counted (see KeyTally); the series stays empty
+    KEY_FETCHING,             // Tallied, and being read back in full by fetchStream
+} KeyMode;
+
+// What a stream keeps of a tallied key: enough for a card or panel value, and where to
+// start reading to recover the key's points
+typedef struct KeyTally_ {
+    int64_t count;
+    int64_t first_step;
+    int64_t last_step;
+    double last_value;        // Value at the highest step (the latest row among equal steps)
+    const char* last_text;    // Unparsed last value, while a chunk is being parsed
+    size_t last_text_len;
+    off_t last_offset;        // Row 'last_value' came from
+    off_t first_offset;       // No row of the key lies before this
+} KeyTally;
+
+// Per-key parse state of a stream (or of a chunk, by chunk-local id), indexed by key id
+typedef struct KeyStates_ {
+    uint8_t* modes;           // KeyMode
+    KeyTally* tallies;
+    int slots;
+} KeyStates;
+
+// One metrics file the loader follows: the main one, or a namespace stream the writer splits
+// off (listed in streams.json). Its series live in a store of its own, but ids come from the
+// loader's one key table, so a key has the same id whichever file it is read from
+typedef struct MetricsStream_ {
+    char* name;               // Namespace, or NULL for the main metrics file
+    void* handle;             // Persistent metrics handle, kept open between refreshes
+    MetricStore* store;       // Per-key step/timestamp/value columns, indexed by key id
+    MetricsSidecar* sidecar;  // Mapped sidecar backing the series it was loaded into
+    MetricsSidecar** retired; // Replaced sidecars, kept mapped while snapshot views may use them
+    int retired_count;
+    off_t cached_offset;      // Metrics offset covered by the sidecar on disk
+    KeyStates states;         // How each key's points are kept, by key id
+    off_t window_from;        // A windowed load never read the rows before this offset
+} MetricsStream;
+
+// Everything below 'thread' is touched only by the loader thread while it runs
+struct DataLoader_ {
+    char* run_path;
+    pthread_t thread;
+    bool running;
+    pthread_mutex_t lock;     // Guards 'requested' and 'stopping' for the condition variable
+    pthread_cond_t wake;
+    bool requested;
+    int* projection;          // Key ids the UI last reported on screen, also guarded by 'lock'
+    int projection_count;
+    bool projection_changed;
+    atomic_bool stopping;     // Also checked between rows, so quitting cuts a long parse short
+    double poll_interval;
+    int notify_read;          // Readable while a published snapshot has not been taken
+    int notify_write;         // Same descriptor as notify_read when it is an eventfd
+    _Atomic(DataSnapshot*) published;
+
+    MetricRecord record;   // Reused parse buffer, so rows do not allocate per field
+    KeyTable* keys;        // Interned keys; ids survive refreshes and truncation
+    MetricsStream** streams;  // The main metrics file first, then namespace streams as they appear
+    int stream_count;
+    FileFingerprint streams_print;  // Version of streams.json the streams were opened from
+    RunFiles* files;          // Run file cache; objects move into snapshots as they change
+    FileFingerprint config_print;   // Versions of the run files already handed to a snapshot
+    FileFingerprint meta_print;
+    FileFingerprint summary_print;
+    bool finished;            // The last summary handed over reported an ended run
+    int64_t window;           // Steps kept per series; 0 keeps the whole history
+    size_t max_memory;        // Bytes every stream's series may take up together; 0 for no limit
+    size_t memory_used;       // What they took up after the last load, under a budget
+    double downsample_ratio;  // Points read per point kept, under a budget
+    int64_t dropped;          // Points lost because a series could not grow
+    bool manifest_checked;    // keys.json is looked at once, on the first load
+    KeyManifest* manifest;    // The writer's key stats, shaping snapshots until history is loaded
+    int* manifest_entry;      // Manifest entry of each key id, or -1
+    int manifest_slots;
+    bool projected;           // A projection was applied: keys met off screen are tallied
+    bool* visible;            // Whether each key id is in the applied projection
+    int visible_slots;
+};
+
+// Where one parse puts the points it reads: the loader's keys and a stream's series, or,
+// for a newline-aligned slice of a large backlog parsed on a worker thread, partial
+// series keyed by chunk-local key ids
 typedef struct {
-    char* key;
-    float* values;
-    int count;
-    int capacity;
-} MetricSeries;
-
-// Finds existing series by key or creates a new one in the list
-static MetricSeries* getSeries(MetricSeries** list, int* count, const char* key) {
-    // Look for existing series with matching key
-    for (int i = 0; i < *count; i++) {
-        if (strcmp((*list)[i].key, key) == 0) { return &(*list)[i]; }
-    }
-    
-    // Expand the series list to accommodate new series
-    MetricSeries* new_list = realloc(*list, (*count + 1) * sizeof(MetricSeries));
-    if (!new_list) return NULL; 
-    
-    *list = new_list;
-    MetricSeries* s = &(*list)[*count];
-    
-    // Initialize new series with duplicated key
-    s->key = strdup(key);
-    if (!s->key) {
+    const char* start;
+    size_t len;
+    off_t offset;             // File offset of 'start'
+    const DataLoader* loader;
+    const MetricsStream* stream;
+    KeyTable* keys;
+    MetricStore* store;
+    KeyStates* states;        // The stream's, or 'local' for a chunk
+    KeyStates local;
+    bool fetch;               // Reading back KEY_FETCHING keys: every other key is skipped
+    int64_t dropped;
+    bool faulted;             // The file shrank under the chunk before it was parsed through
+} MetricsChunk;
+
+// Grows a key state table to at least 'slots' ids; new ids are unseen
+static bool reserveStates(KeyStates* states, int slots) {
+    if (slots <= states->slots) return true;
+
+    int new_slots = states->slots ? states->slots : 64;
+    while (new_slots < slots) new_slots *= 2;
+    uint8_t* modes = realloc(states->modes, (size_t)new_slots);
+    if (modes) states->modes = modes;
+    KeyTally* tallies = realloc(states->tallies, (size_t)new_slots * sizeof(KeyTally));
+    if (tallies) states->tallies = tallies;
+    if (!modes || !tallies) return false;
+
+    memset(modes + states->slots, KEY_UNSEEN, (size_t)(new_slots - states->slots));
+    memset(tallies + states->slots, 0, (size_t)(new_slots - states->slots) * sizeof(KeyTally));
+    states->slots = new_slots;
+    return true;
+}
+
+// Frees a key state table
+static void freeStates(KeyStates* states) {
+    free(states->modes);
+    free(states->tallies);
+    memset(states, 0, sizeof(KeyStates));
+}
+
+// Returns the mode of key 'id' in a stream (unseen for ids it never met, and for -1)
+static KeyMode streamMode(const MetricsStream* s, int id) {
+    return id >= 0 && id < s->states.slots ? (KeyMode)s->states.modes[id] : KEY_UNSEEN;
+}
+
+// Returns true if key 'id' is in the projection the loader last applied
+static bool isVisible(const DataLoader* this, int id) {
+    return id >= 0 && id < this->visible_slots && this->visible[id];
+}
+
+// Decides how a stream keeps a key it meets for the first time ('id' is -1 for a key
+// still unknown to the loader). Points already in its series (from a sidecar) stay there
+static KeyMode firstSightMode(const DataLoader* this, const MetricsStream* s, int id) {
+    const MetricSeries* series = id >= 0 ? MetricStore_get(s->store, id) : NULL;
+    if (series && series->count > 0) return KEY_STORED;
+    return this->projected && !isVisible(this, id) ? KEY_TALLIED : KEY_STORED;
+}
+
+// Returns how a parse treats key 'id' of its key table, settling it on first sight. A chunk
+// takes the stream's mode; the stream itself is only updated when the chunk is merged
+static KeyMode keyMode(MetricsChunk* c, int id) {
+    KeyStates* states = c->states;
+    if (id < states->slots && states->modes[id] != KEY_UNSEEN) return (KeyMode)states->modes[id];
+    if (!reserveStates(states, id + 1)) return c->fetch ? KEY_UNSEEN : KEY_STORED;
+
+    int global = id;
+    if (c->keys != c->loader->keys) {
+        const KeyInfo* key = KeyTable_get(c->keys, id);
+        global = KeyTable_find(c->loader->keys, key->name, key->len);
+    }
+    KeyMode mode = streamMode(c->stream, global);
+    if (mode == KEY_UNSEEN) mode = firstSightMode(c->loader, c->stream, global);
+    states->modes[id] = (uint8_t)mode;
+    return mode;
+}
+
+// Counts a point of a tallied key, read from the row at 'offset'. A deferred value is
+// kept as text until the parse is done (see resolveTally), so only the last one is parsed
+static void tallyPoint(KeyTally* t, int64_t step, off_t offset, const MetricField* f) {
+    if (t->count == 0 || step > t->last_step || (step == t->last_step && offset >= t->last_offset)) {
+        t->last_step = step;
+        t->last_offset = offset;
+        t->last_value = f->value;
+        t->last_text = f->text;
+        t->last_text_len = f->text_len;
+    }
+    if (t->count == 0 || step < t->first_step) t->first_step = step;
+    if (t->count == 0 || offset < t->first_offset) t->first_offset = offset;
+    t->count++;
+}
+
+// Parses the deferred last value of a tally, before the text it points into goes away
+static void resolveTally(KeyTally* t) {
+    if (!t->last_text) return;
+    MetricField f = { .text = t->last_text, .text_len = t->last_text_len };
+    if (!MetricsParser_fieldValue(&f, &t->last_value)) t->last_value = NAN;
+    t->last_text = NULL;
+}
+
+// Adds the tally of a later-merged parse to 'dst'
+static void mergeTally(KeyTally* dst, const KeyTally* src) {
+    if (src->count == 0) return;
+    if (dst->count == 0) {
+        *dst = *src;
+        return;
+    }
+    if (src->last_step > dst->last_step || (src->last_step == dst->last_step && src->last_offset >= dst->last_offset)) {
+        dst->last_step = src->last_step;
+        dst->last_offset = src->last_offset;
+        dst->last_value = src->last_value;
+    }
+    if (src->first_step < dst->first_step) dst->first_step = src->first_step;
+    if (src->first_offset < dst->first_offset) dst->first_offset = src->first_offset;
+    dst->count += src->count;
+}
+
+// Takes in every plottable field of a parsed row, read from the file at 'offset': the
+// points of stored keys go into their series (counting those there was no memory for in
+// 'dropped'), those of tallied keys only into their tallies. Returns true if anything changed
+static bool addRecord(MetricsChunk* c, const MetricRecord* record, off_t offset) {
+    bool added = false;
+    for (size_t i = 0; i < record->count; i++) {
+        const MetricField* f = &record->fields[i];
+
+        // Intern once per row field; internal fields (prefixed with '_') are not plotted
+        int id = KeyTable_intern(c->keys, f->key, f->key_len);
+        const KeyInfo* key = KeyTable_get(c->keys, id);
+        if (!key || key->is_internal || f->key_len == 0) continue;
+
+        KeyMode mode = keyMode(c, id);
+        if (c->fetch && mode != KEY_FETCHING) continue;
+        if (!c->fetch && mode != KEY_STORED) {
+            // Off screen: count the point without parsing its value
+            tallyPoint(&c->states->tallies[id], record->step, offset, f);
+            added = true;
+            continue;
+        }
+
+        // A deferred number that turns out malformed is skipped like any unplottable value
+        double value;
+        if (!MetricsParser_fieldValue(f, &value)) continue;
+
+        // Get or create series for this metric key
+        MetricSeries* s = MetricStore_getOrCreate(c->store, id);
+        if (s && MetricStore_append(s, record->step, record->timestamp, value)) {
+            added = true;
+        } else {
+            c->dropped++;
+        }
+    }
+    return added;
+}
+
+// Returns a parse that reads straight into a stream's series and key states
+static MetricsChunk streamSink(DataLoader* this, MetricsStream* s) {
+    MetricsChunk sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.loader = this;
+    sink.stream = s;
+    sink.keys = this->keys;
+    sink.store = s->store;
+    sink.states = &s->states;
+    return sink;
+}
+
+// Frees a stream, its open metrics handle, its series and every sidecar it mapped
+static void deleteStream(MetricsStream* s) {
+    if (!s) return;
+    Storage_closeMetrics(s->handle);
+    MetricStore_delete(s->store);
+    Storage_closeSidecar(s->sidecar);
+    for (int i = 0; i < s->retired_count; i++) Storage_closeSidecar(s->retired[i]);
+    freeStates(&s->states);
+    free(s->retired);
+    free(s->name);
+    free(s);
+}
+
+// Adds a stream for the namespace 'name' (NULL for the main metrics file). Its file is
+// opened on the next load. Returns false on allocation failure
+static bool addStream(DataLoader* this, const char* name) {
+    MetricsStream* s = calloc(1, sizeof(MetricsStream));
+    MetricsStream** streams = realloc(this->streams, (this->stream_count + 1) * sizeof(MetricsStream*));
+    if (streams) this->streams = streams;
+    if (s) {
+        s->name = name ? strdup(name) : NULL;
+        s->store = MetricStore_new();
+    }
+    if (!s || !streams || !s->store || (name && !s->name)) {
+        deleteStream(s);
+        return false;
+    }
+    this->streams[this->stream_count++] = s;
+    return true;
+}
+
+// Creates a loader that incrementally follows the metrics of a run directory
+DataLoader* DataLoader_new(const char* run_path) {
+    DataLoader* this = calloc(1, sizeof(DataLoader));
+    if (!this) return NULL;
+
+    this->run_path = strdup(run_path);
+    if (!this->run_path) {
+        free(this);
         return NULL;
     }
-    
-    s->count = 0;
-    s->capacity = METRIC_INITIAL_CAPACITY;
-    s->values = malloc(s->capacity * sizeof(float));
-    
-    // Clean up key if values allocation fails
-    if (!s->values) {
-        free(s->key);
-        s->key = NULL;  // Mark as invalid
+    this->keys = KeyTable_new();
+    this->files = Storage_openRunFiles(run_path);
+    if (!this->keys || !this->files || !addStream(this, NULL)) {
+        KeyTable_delete(this->keys);
+        Storage_closeRunFiles(this->files);
+        free(this->streams);
+        free(this->run_path);
+        free(this);
         return NULL;
     }
-    
-    // Only increment count after successful allocation
-    (*count)++;
-    return s;
-}
-
-// Appends a value to a metric series, expanding capacity if needed
-static void appendValue(MetricSeries* s, float val) {
-    if (!s || !s->values) return;
-    
-    // Double capacity when full
-    if (s->count >= s->capacity) {
-        s->capacity *= 2;
-        float* new_vals = realloc(s->values, s->capacity * sizeof(float));
-        if (!new_vals) {
-            // Silently drop value on allocation failure - series remains valid
-            return;
-        }
-        s->values = new_vals;
-    }
-    s->values[s->count++] = val;
-}
-
-// Frees all memory associated with a list of metric series
-static void freeAllSeries(MetricSeries* list, int count) {
-    if (!list) return;
-    for (int i = 0; i < count; i++) {
-        free(list[i].key);
-        free(list[i].values);
-    }
-    free(list);
-}
-
-// Loads metrics and system data from a run directory and populates the corresponding panels
-void DataLoader_loadMetrics(const char* run_path, Panel* metricsPanel, Panel* systemPanel) {
-    void* handle = Storage_openMetrics(run_path);
-    if (!handle) return;
-
-    MetricSeries* all_series = NULL;
-    int series_count = 0;
-
-    // Read all metric entries and organize into series
-    MetricEntry* entry;
-    while ((entry = Storage_readNextMetric(handle)) != NULL) {
-        if (entry->json) {
-            cJSON* item;
-            // Iterate through all fields in the JSON object
-            cJSON_ArrayForEach(item, entry->json) {
-                // Skip internal fields (prefixed with '_') and non-numeric values
-                if (item->string[0] == '_') continue;
-                if (!cJSON_IsNumber(item)) continue;
-
-                // Get or create series for this metric key
-                MetricSeries* s = getSeries(&all_series, &series_count, item->string);
-                if (s) {
-                    appendValue(s, (float)item->valuedouble);
+    MetricRecord_init(&this->record);
+    pthread_mutex_init(&this->lock, NULL);
+    pthread_cond_init(&this->wake, NULL);
+    atomic_init(&this->stopping, false);
+    atomic_init(&this->published, NULL);
+    this->notify_read = -1;
+    this->notify_write = -1;
+    return this;
+}
+
+// Stops the loader thread and frees the loader, its open metrics handle, all accumulated
+// series and any snapshot not yet taken
+void DataLoader_delete(DataLoader* this) {
+    if (!this) return;
+    DataLoader_stop(this);
+    DataSnapshot_delete(atomic_exchange(&this->published, NULL));
+
+    if (this->notify_write >= 0 && this->notify_write != this->notify_read) close(this->notify_write);
+    if (this->notify_read >= 0) close(this->notify_read);
+    pthread_cond_destroy(&this->wake);
+    pthread_mutex_destroy(&this->lock);
+
+    for (int i = 0; i < this->stream_count; i++) deleteStream(this->streams[i]);
+    free(this->streams);
+    free(this->projection);
+    free(this->visible);
+    MetricRecord_done(&this->record);
+    Storage_closeRunFiles(this->files);
+    Storage_freeKeyManifest(this->manifest);
+    free(this->manifest_entry);
+    KeyTable_delete(this->keys);
+    free(this->run_path);
+    free(this);
+}
+
+// Returns the name a stream goes by in the log
+static const char* streamLabel(const MetricsStream* s) {
+    return s->name ? s->name : "main";
+}
+
+// Drops every series and tally of a stream (used when its file was truncated or replaced).
+// Interned keys are kept, so ids stay stable across the reset
+static void resetSeries(MetricsStream* s) {
+    MetricStore_clear(s->store);
+    freeStates(&s->states);
+    s->window_from = 0;
+
+    // The sidecar described the old file. Views in snapshots the UI still shows may point
+    // into its mapping, so it stays mapped until the loader goes away
+    if (s->sidecar) {
+        MetricsSidecar** retired = realloc(s->retired, (s->retired_count + 1) * sizeof(MetricsSidecar*));
+        if (retired) {
+            s->retired = retired;
+            s->retired[s->retired_count++] = s->sidecar;
+        } else {
+            LOG_WARN("Leaking replaced metrics sidecar mapping");
+        }
+    }
+    s->sidecar = NULL;
+    s->cached_offset = 0;
+}
+
+// Adopts the columns of a stream's valid sidecar as its initial series, without copying,
+// and positions its metrics handle after the rows the sidecar already covers
+static bool loadSidecar(DataLoader* this, MetricsStream* s) {
+    // The sidecar holds the whole history, which a windowed loader would only throw away
+    if (this->window > 0) return false;
+
+    MetricsSidecar* sc = Storage_openSidecar(s->handle);
+    if (!sc) return false;
+
+    if (!Storage_seekMetrics(s->handle, sc->source_offset)) {
+        Storage_closeSidecar(sc);
+        return false;
+    }
+    s->sidecar = sc;
+    s->cached_offset = sc->source_offset;
+
+    for (int i = 0; i < sc->column_count; i++) {
+        const SidecarColumn* c = &sc->columns[i];
+        int id = KeyTable_intern(this->keys, c->key, c->key_len);
+        if (c->count > 0) MetricStore_adopt(s->store, id, c->steps, c->timestamps, c->values, (int64_t)c->count);
+    }
+
+    LOG_INFO("Loaded %d keys from the %s stream's sidecar (%lld bytes covered)", sc->column_count, streamLabel(s),
+             (long long)sc->source_offset);
+    return true;
+}
+
+static bool fetchKeys(DataLoader* this, MetricsStream* s, bool all);
+
+// Starts a stream over after its metrics file shrank under a guarded read: everything read
+// is dropped and the file reopened, so the next load reads it as it is now
+static void recoverStream(MetricsStream* s) {
+    LOG_WARN("The %s stream's metrics file shrank while it was being read; reloading it", streamLabel(s));
+    Storage_reopenMetrics(s->handle);
+    resetSeries(s);
+}
+
+// Returns true if the memory budget cost any series of a stream some of its points
+static bool isDownsampled(const MetricsStream* s) {
+    for (int id = 0; id < MetricStore_count(s->store); id++) {
+        const MetricSeries* series = MetricStore_get(s->store, id);
+        if (series && series->merged > 0) return true;
+    }
+    return false;
+}
+
+// Writes a stream's sidecar and step index for everything read from it so far, unless
+// they are already current. A sidecar needs every key's points: tallied keys are read back
+// first if 'fetch' is set, and otherwise no sidecar is written
+static bool saveStreamCache(DataLoader* this, MetricsStream* s, bool fetch) {
+    if (!s->handle) return false;
+
+    if (Storage_saveStepIndex(s->handle)) {
+        LOG_INFO("Wrote the %s stream's step index for %s", streamLabel(s), this->run_path);
+    }
+
+    off_t offset = Storage_getMetricsOffset(s->handle);
+    if (offset == s->cached_offset || this->window > 0 || isDownsampled(s)) return false;
+
+    for (int id = 0; id < s->states.slots; id++) {
+        if (s->states.modes[id] != KEY_TALLIED || s->states.tallies[id].count == 0) continue;
+        if (!fetch || atomic_load(&this->stopping) || !fetchKeys(this, s, true)) return false;
+        MetricStore_sortPending(s->store);
+        break;
+    }
+
+    // One column per interned key, in id order, so ids come back identical on reload. Keys
+    // of other streams get empty columns
+    int count = KeyTable_count(this->keys);
+    SidecarColumn* columns = calloc(count ? count : 1, sizeof(SidecarColumn));
+    void** expanded = calloc(count ? count : 1, sizeof(void*));
+    if (!columns || !expanded) {
+        free(columns);
+        free(expanded);
+        return false;
+    }
+
+    // The sidecar stores plain columns: series with sealed blocks are expanded for the write
+    bool ok = true;
+    for (int id = 0; id < count; id++) {
+        const KeyInfo* key = KeyTable_get(this->keys, id);
+        columns[id].key = key->name;
+        columns[id].key_len = key->len;
+        const MetricSeries* series = MetricStore_get(s->store, id);
+        if (!series) continue;
+
+        columns[id].count = series->count;
+        if (series->sealed == 0) {
+            columns[id].steps = series->steps;
+            columns[id].timestamps = series->timestamps;
+            columns[id].values = series->values;
+            continue;
+        }
+
+        expanded[id] = malloc((size_t)series->count * (sizeof(int64_t) + 2 * sizeof(double)));
+        if (!expanded[id]) {
+            ok = false;
+            break;
+        }
+        int64_t* steps = expanded[id];
+        double* timestamps = (double*)(steps + series->count);
+        double* values = timestamps + series->count;
+        MetricStore_read(series, 0, series->count, steps, timestamps, values);
+        columns[id].steps = steps;
+        columns[id].timestamps = timestamps;
+        columns[id].values = values;
+    }
+
+    if (ok) ok = Storage_writeSidecar(s->handle, columns, count);
+    for (int id = 0; id < count; id++) free(expanded[id]);
+    free(expanded);
+    free(columns);
+
+    if (ok) {
+        s->cached_offset = offset;
+        LOG_INFO("Wrote the %s stream's sidecar for %d keys (%lld bytes covered)", streamLabel(s), count,
+                 (long long)offset);
+    } else {
+        LOG_WARN("Could not write the %s stream's sidecar in %s", streamLabel(s), this->run_path);
+    }
+    return ok;
+}
+
+// Writes each stream's sidecar and step index, reading back tallied keys for it if 'fetch'
+static bool saveCaches(DataLoader* this, bool fetch) {
+    bool saved = false;
+    for (int i = 0; i < this->stream_count; i++) {
+        if (saveStreamCache(this, this->streams[i], fetch)) saved = true;
+    }
+    return saved;
+}
+
+// Writes each stream's sidecar and step index for everything read so far, unless they are
+// already current. Streams with tallied keys get no sidecar: reading them back is left to
+// the loader thread, so quitting never waits for it
+bool DataLoader_saveCache(DataLoader* this) {
+    if (!this) return false;
+    return saveCaches(this, false);
+}
+
+// Worker: parses every line of one chunk into chunk-local keys, series and tallies.
+// Numbers are only parsed for the keys that are stored. A chunk whose bytes vanish from
+// under it is marked faulted and left partly parsed
+static void* parseChunk(void* arg) {
+    MetricsChunk* c = (MetricsChunk*)arg;
+    MetricRecord record;
+    MetricRecord_init(&record);
+    record.defer_values = true;
+
+    MappingGuard guard;
+    if (sigsetjmp(guard.env, 1)) {
+        c->faulted = true;
+        MetricRecord_done(&record);
+        return NULL;
+    }
+    Storage_armGuard(&guard);
+
+    const char* p = c->start;
+    const char* end = c->start + c->len;
+    while (p < end) {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        if (!newline) newline = end;
+        if (MetricsParser_parseLine(p, (size_t)(newline - p), &record)) {
+            addRecord(c, &record, c->offset + (off_t)(p - c->start));
+        }
+        p = newline + 1;
+    }
+
+    for (int id = 0; id < c->local.slots; id++) resolveTally(&c->local.tallies[id]);
+    Storage_disarmGuard(&guard);
+    MetricRecord_done(&record);
+    return NULL;
+}
+
+// Widens a view to the ranges the key manifest reports for the whole history, so charts
+// keep their final axes while the history fills in. A view with no points yet takes the
+// manifest's ranges and last value as they are
+static void applyManifest(MetricView* view, const KeyManifestEntry* e) {
+    if (view->count == 0) {
+        view->first_step = e->first_step;
+        view->last_step = e->last_step;
+        view->last_value = e->last_value;
+        view->min_value = e->min_value;
+        view->max_value = e->max_value;
+        view->min_timestamp = INFINITY;
+        view->max_timestamp = -INFINITY;
+        return;
+    }
+    if (e->first_step < view->first_step) view->first_step = e->first_step;
+    if (e->last_step > view->last_step) view->last_step = e->last_step;
+    if (e->min_value < view->min_value) view->min_value = e->min_value;
+    if (e->max_value > view->max_value) view->max_value = e->max_value;
+}
+
+// Returns the series of key 'id' from the first stream that has points for it, or NULL.
+// A key lives in one stream unless the writer changed how it splits namespaces mid-run
+static const MetricSeries* findSeries(DataLoader* this, int id) {
+    for (int i = 0; i < this->stream_count; i++) {
+        const MetricSeries* s = MetricStore_get(this->streams[i]->store, id);
+        if (s && s->count > 0) return s;
+    }
+    return NULL;
+}
+
+// Returns the tally of key 'id' from the first stream that tallied points of it, or NULL
+static const KeyTally* findTally(DataLoader* this, int id) {
+    for (int i = 0; i < this->stream_count; i++) {
+        const MetricsStream* s = this->streams[i];
+        KeyMode mode = streamMode(s, id);
+        if ((mode == KEY_TALLIED || mode == KEY_FETCHING) && s->states.tallies[id].count > 0) {
+            return &s->states.tallies[id];
+        }
+    }
+    return NULL;
+}
+
+// Gives the empty view of a tallied key its step span and last value. A view already
+// shaped by the key manifest is only widened, and keeps the manifest's value ranges
+static void applyTally(MetricView* view, const KeyTally* t, bool shaped) {
+    if (!shaped) {
+        view->first_step = t->first_step;
+        view->last_step = t->last_step;
+        view->last_value = t->last_value;
+        view->min_value = INFINITY;
+        view->max_value = -INFINITY;
+        view->min_timestamp = INFINITY;
+        view->max_timestamp = -INFINITY;
+        return;
+    }
+    if (t->last_step >= view->last_step) view->last_value = t->last_value;
+    if (t->first_step < view->first_step) view->first_step = t->first_step;
+    if (t->last_step > view->last_step) view->last_step = t->last_step;
+}
+
+// Takes a view of every non-empty series, in id order, for a history load 'percent'
+// complete. Until it completes, keys from the manifest are included (and widened) even
+// if none of their rows has been read yet. Returns false on allocation failure
+static bool snapshotMetrics(DataLoader* this, DataSnapshot* snap, int percent) {
+    int count = KeyTable_count(this->keys);
+    snap->metrics = calloc(count ? count : 1, sizeof(SnapshotMetric));
+    if (!snap->metrics) return false;
+
+    bool shaped = this->manifest && percent < 100;
+    for (int id = 0; id < count; id++) {
+        const MetricSeries* s = findSeries(this, id);
+        const KeyTally* t = s ? NULL : findTally(this, id);
+        const KeyInfo* key = KeyTable_get(this->keys, id);
+        int entry = shaped && id < this->manifest_slots ? this->manifest_entry[id] : -1;
+        if (!key || (!s && !t && entry < 0)) continue;
+
+        SnapshotMetric* m = &snap->metrics[snap->metric_count++];
+        m->id = id;
+        m->name = key->name;
+        m->display_name = key->display_name;
+        m->is_system = key->is_system;
+        m->unit = key->unit;
+        m->view = MetricStore_view(s);
+        if (entry >= 0) applyManifest(&m->view, &this->manifest->keys[entry]);
+        if (t) {
+            applyTally(&m->view, t, entry >= 0);
+            m->tallied = t->count;
+        }
+    }
+    snap->metrics_changed = true;
+    snap->load_percent = percent;
+    snap->memory_used = this->memory_used;
+    snap->downsample_ratio = this->downsample_ratio;
+    return true;
+}
+
+// Returns true for the statuses a run never leaves
+static bool isFinalStatus(const char* status) {
+    return status && (strcmp(status, "FINISHED") == 0 || strcmp(status, "FAILED") == 0 ||
+                      strcmp(status, "CRASHED") == 0 || strcmp(status, "STOPPED") == 0);
+}
+
+// Moves the run file objects whose files changed since the last snapshot into 'snap'.
+// The cache keeps only the fingerprints, which is all it needs to notice the next change
+static void snapshotRunFiles(DataLoader* this, DataSnapshot* snap) {
+    RunFiles* files = this->files;
+    if (!Storage_refreshRunFiles(files)) return;
+
+    if (!Storage_sameFingerprint(&files->config_print, &this->config_print)) {
+        snap->config = files->config;
+        snap->files_changed |= SNAPSHOT_CONFIG;
+        files->config = NULL;
+        this->config_print = files->config_print;
+    }
+    if (!Storage_sameFingerprint(&files->meta_print, &this->meta_print)) {
+        snap->meta = files->meta;
+        snap->files_changed |= SNAPSHOT_METADATA;
+        files->meta = NULL;
+        this->meta_print = files->meta_print;
+    }
+    if (!Storage_sameFingerprint(&files->summary_print, &this->summary_print)) {
+        snap->summary = files->summary;
+        snap->files_changed |= SNAPSHOT_SUMMARY;
+        files->summary = NULL;
+        this->summary_print = files->summary_print;
+        this->finished = snap->summary && isFinalStatus(snap->summary->status);
+    }
+}
+
+// Moves whatever 'older' carries that 'newer' does not into 'newer', so skipping a
+// snapshot the UI never took loses nothing
+static void foldSnapshot(DataSnapshot* newer, DataSnapshot* older) {
+    if (!newer->metrics_changed && older->metrics_changed) {
+        free(newer->metrics);
+        newer->metrics = older->metrics;
+        newer->metric_count = older->metric_count;
+        newer->metrics_changed = true;
+        newer->load_percent = older->load_percent;
+        newer->memory_used = older->memory_used;
+        newer->downsample_ratio = older->downsample_ratio;
+        older->metrics = NULL;
+        older->metric_count = 0;
+        older->metrics_changed = false;
+    }
+    if (!(newer->files_changed & SNAPSHOT_CONFIG) && (older->files_changed & SNAPSHOT_CONFIG)) {
+        newer->config = older->config;
+        older->config = NULL;
+    }
+    if (!(newer->files_changed & SNAPSHOT_METADATA) && (older->files_changed & SNAPSHOT_METADATA)) {
+        newer->meta = older->meta;
+        older->meta = NULL;
+    }
+    if (!(newer->files_changed & SNAPSHOT_SUMMARY) && (older->files_changed & SNAPSHOT_SUMMARY)) {
+        newer->summary = older->summary;
+        older->summary = NULL;
+    }
+    newer->files_changed |= older->files_changed;
+}
+
+// Makes 'snap' the latest snapshot and wakes the UI
+static void publishSnapshot(DataLoader* this, DataSnapshot* snap) {
+    // Fold in a snapshot the UI has not taken yet before this one becomes visible
+    DataSnapshot* stale = atomic_exchange(&this->published, NULL);
+    if (stale) {
+        foldSnapshot(snap, stale);
+        DataSnapshot_delete(stale);
+    }
+    atomic_store(&this->published, snap);
+
+    uint64_t one = 1;
+    if (write(this->notify_write, &one, this->notify_write == this->notify_read ? sizeof(one) : 1) < 0 &&
+        errno != EAGAIN) {
+        LOG_WARN("Could not signal a new metrics snapshot");
+    }
+}
+
+// Returns the bytes every stream's series take up, adding up the points they keep and the
+// points downsampling folded away
+static size_t measureSeries(DataLoader* this, int64_t* points, int64_t* merged) {
+    size_t bytes = 0;
+    *points = *merged = 0;
+    for (int i = 0; i < this->stream_count; i++) {
+        MetricStore* store = this->streams[i]->store;
+        for (int id = 0; id < MetricStore_count(store); id++) {
+            const MetricSeries* s = MetricStore_get(store, id);
+            if (!s) continue;
+            bytes += MetricStore_bytes(s);
+            *points += s->count;
+            *merged += s->merged;
+        }
+    }
+    return bytes;
+}
+
+// Brings every stream's series back within the memory budget. Settled points are compressed
+// first, even midway through a history load ('compacted' says whether that already happened);
+// only then does the largest series give up resolution in its older half, until they fit
+static void enforceBudget(DataLoader* this, bool compacted) {
+    int64_t points, merged;
+    size_t used = measureSeries(this, &points, &merged);
+    if (used > this->max_memory && !compacted) {
+        for (int i = 0; i < this->stream_count; i++) MetricStore_compact(this->streams[i]->store);
+        used = measureSeries(this, &points, &merged);
+    }
+
+    int passes = 0;
+    while (used > this->max_memory) {
+        MetricStore* largest = NULL;
+        int largest_id = -1;
+        size_t largest_bytes = 0;
+        for (int i = 0; i < this->stream_count; i++) {
+            MetricStore* store = this->streams[i]->store;
+            for (int id = 0; id < MetricStore_count(store); id++) {
+                const MetricSeries* s = MetricStore_get(store, id);
+                size_t bytes = MetricStore_bytes(s);
+                if (s && s->count >= 2 * DOWNSAMPLE_BUCKET_POINTS && bytes > largest_bytes) {
+                    largest = store;
+                    largest_id = id;
+                    largest_bytes = bytes;
                 }
             }
         }
-        Storage_freeMetricEntry(entry);
+        if (!largest || !MetricStore_downsample(largest, largest_id)) break;
+
+        size_t bytes = MetricStore_bytes(MetricStore_get(largest, largest_id));
+        used = used - largest_bytes + bytes;
+        passes++;
+    }
+    if (passes > 0) {
+        used = measureSeries(this, &points, &merged);
+        LOG_INFO("Took %d downsampling passes to fit a %zu byte budget: %zu bytes, %lld points kept of %lld", passes,
+                 this->max_memory, used, (long long)points, (long long)(points + merged));
+    }
+    if (used > this->max_memory) LOG_WARN("Metrics take %zu bytes, over the %zu byte budget", used, this->max_memory);
+
+    this->memory_used = used;
+    this->downsample_ratio = points > 0 ? (double)(points + merged) / (double)points : 1.0;
+}
+
+// Sorts and seals (or trims to the window) what was just loaded, brings it within the memory
+// budget if there is one, and publishes it as a snapshot that shows the history load
+// 'percent' complete
+static void publishMetrics(DataLoader* this, int percent) {
+    // Late rows were appended as they came; put every series back in step order, then
+    // compress the points that have settled. Midway through a history load every slice
+    // lands in front of the last, so sealing waits until the end rather than reopen blocks.
+    // A windowed store never seals: its points are dropped long before they would settle
+    for (int i = 0; i < this->stream_count; i++) {
+        MetricStore* store = this->streams[i]->store;
+        MetricStore_sortPending(store);
+        if (this->window > 0) {
+            MetricStore_trim(store, this->window);
+        } else if (percent == 100) {
+            MetricStore_compact(store);
+        }
     }
-    Storage_closeMetrics(handle);
+    if (this->max_memory > 0) enforceBudget(this, percent == 100);
+
+    DataSnapshot* snap = calloc(1, sizeof(DataSnapshot));
+    if (!snap || !snapshotMetrics(this, snap, percent)) {
+        LOG_WARN("Could not allocate a metrics snapshot");
+        DataSnapshot_delete(snap);
+        return;
+    }
+    publishSnapshot(this, snap);
+
+    // Once the history is in, the series say everything the manifest did
+    if (percent == 100 && this->manifest) {
+        Storage_freeKeyManifest(this->manifest);
+        this->manifest = NULL;
+    }
+}
+
+// Reads the writer's keys.json and publishes a snapshot laid out from it alone, so a cold
+// open shows every card and panel value, with its final axes, before any row is parsed.
+// Keys are interned in manifest order, which is their order of first appearance. A
+// windowed loader reads only a little anyway and has no use for whole-history ranges
+static void loadManifest(DataLoader* this) {
+    if (this->window > 0) return;
+    KeyManifest* manifest = Storage_readKeyManifest(this->run_path);
+    if (!manifest) return;
+
+    int* entry = NULL;
+    int slots = 0;
+    for (int i = 0; i < manifest->count; i++) {
+        const char* name = manifest->keys[i].name;
+        int id = KeyTable_intern(this->keys, name, strlen(name));
+        if (id < 0) continue;
+        if (id >= slots) {
+            int new_slots = id + 1 > slots * 2 ? id + 1 : slots * 2;
+            int* grown = realloc(entry, new_slots * sizeof(int));
+            if (!grown) break;
+            for (int j = slots; j < new_slots; j++) grown[j] = -1;
+            entry = grown;
+            slots = new_slots;
+        }
+        entry[id] = i;
+    }
+    this->manifest = manifest;
+    this->manifest_entry = entry;
+    this->manifest_slots = slots;
+
+    DataSnapshot* snap = calloc(1, sizeof(DataSnapshot));
+    if (!snap || !snapshotMetrics(this, snap, 0)) {
+        DataSnapshot_delete(snap);
+        return;
+    }
+    publishSnapshot(this, snap);
+    LOG_INFO("Laid out %d keys from the key manifest (%lld bytes covered)", manifest->count,
+             (long long)manifest->covered_offset);
+}
+
+// Parses the lines of [data, data + len), which must end just after a newline and start
+// at file offset 'offset', and appends their points to the store in file order (or, to
+// 'fetch', only those of the keys being fetched). A slice of PARALLEL_MIN_BYTES or more is
+// cut into chunks parsed on up to PARALLEL_MAX_WORKERS threads; each fills partial series
+// and tallies that are then merged in chunk order, so the result matches a sequential read.
+// Returns false on allocation failure or a read fault, leaving a partial merge behind
+static bool parseSlice(DataLoader* this, MetricsStream* s, const char* data, size_t len, off_t offset, bool fetch) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cpus < 1 ? 1 : (cpus > PARALLEL_MAX_WORKERS ? PARALLEL_MAX_WORKERS : (int)cpus);
+    if (len < PARALLEL_MIN_BYTES) workers = 1;
+
+    MetricsChunk* chunks = calloc(workers, sizeof(MetricsChunk));
+    pthread_t* threads = calloc(workers, sizeof(pthread_t));
+    bool* started = calloc(workers, sizeof(bool));
+    if (!chunks || !threads || !started) {
+        free(chunks);
+        free(threads);
+        free(started);
+        return false;
+    }
+
+    // Cut at roughly equal byte offsets, each moved forward to just past a newline
+    size_t begin = 0;
+    int chunk_count = 0;
+    for (int i = 0; i < workers && begin < len; i++) {
+        size_t cut = (i == workers - 1) ? len : len / workers * (i + 1);
+        if (cut < begin) cut = begin;
+        const char* newline = memchr(data + cut, '\n', len - cut);
+        size_t finish = newline ? (size_t)(newline - data) + 1 : len;
+
+        MetricsChunk* c = &chunks[chunk_count++];
+        c->start = data + begin;
+        c->len = finish - begin;
+        c->offset = offset + (off_t)begin;
+        c->loader = this;
+        c->stream = s;
+        c->keys = KeyTable_new();
+        c->store = MetricStore_new();
+        c->states = &c->local;
+        c->fetch = fetch;
+        begin = finish;
+    }
+
+    // The calling thread takes the first chunk itself; a chunk whose thread cannot be
+    // started is parsed inline as well
+    for (int i = 1; i < chunk_count; i++) {
+        started[i] = chunks[i].keys && chunks[i].store && pthread_create(&threads[i], NULL, parseChunk, &chunks[i]) == 0;
+    }
+    for (int i = 0; i < chunk_count; i++) {
+        if (i == 0 || !started[i]) {
+            if (chunks[i].keys && chunks[i].store) parseChunk(&chunks[i]);
+        } else {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    // Merge in chunk order. Interning the chunk's keys in their local id order reproduces
+    // the global ids a sequential read would have assigned. Keys the stream meets for the
+    // first time take the mode the chunk settled on
+    bool ok = true;
+    for (int i = 0; i < chunk_count; i++) {
+        MetricsChunk* c = &chunks[i];
+        this->dropped += c->dropped;
+        ok = ok && c->keys != NULL && c->store != NULL && !c->faulted;
+        int key_count = ok ? KeyTable_count(c->keys) : 0;
+        for (int local = 0; ok && local < key_count; local++) {
+            const KeyInfo* key = KeyTable_get(c->keys, local);
+            int id = KeyTable_intern(this->keys, key->name, key->len);
+            const MetricSeries* part = MetricStore_get(c->store, local);
+            if (part) ok = MetricStore_appendSeries(MetricStore_getOrCreate(s->store, id), part);
+
+            KeyMode mode = local < c->local.slots ? (KeyMode)c->local.modes[local] : KEY_UNSEEN;
+            if (fetch || mode == KEY_UNSEEN) continue;
+            ok = ok && reserveStates(&s->states, id + 1);
+            if (!ok) break;
+            if (s->states.modes[id] == KEY_UNSEEN) s->states.modes[id] = (uint8_t)mode;
+            if (mode == KEY_TALLIED) mergeTally(&s->states.tallies[id], &c->local.tallies[local]);
+        }
+        MetricStore_delete(c->store);
+        KeyTable_delete(c->keys);
+        freeStates(&c->local);
+    }
+    free(chunks);
+    free(threads);
+    free(started);
+
+    if (chunk_count > 1) LOG_INFO("Parsed %zu bytes of metrics on %d threads", len, chunk_count);
+    return ok;
+}
+
+// Returns the step of the first row in [line, line + len) that has one, or -1
+static int64_t firstRowStep(DataLoader* this, const char* line, size_t len) {
+    const char* end = line + len;
+    while (line < end) {
+        const char* newline = memchr(line, '\n', (size_t)(end - line));
+        if (!newline) newline = end;
+        if (MetricsParser_parseLine(line, (size_t)(newline - line), &this->record) && this->record.step >= 0) {
+            return this->record.step;
+        }
+        line = newline + 1;
+    }
+    return -1;
+}
+
+// Returns the step of the last row in [data, data + len) that has one, or -1
+static int64_t lastRowStep(DataLoader* this, const char* data, size_t len) {
+    size_t end = len;
+    while (end > 0) {
+        size_t begin = end - 1;
+        while (begin > 0 && data[begin - 1] != '\n') begin--;
+        if (MetricsParser_parseLine(data + begin, end - begin, &this->record) && this->record.step >= 0) {
+            return this->record.step;
+        }
+        end = begin;
+    }
+    return -1;
+}
+
+// Turns a stored key of a stream into a tally of its series, and drops the series
+static void demoteKey(MetricsStream* s, int id) {
+    KeyTally* t = &s->states.tallies[id];
+    memset(t, 0, sizeof(KeyTally));
+
+    const MetricSeries* series = MetricStore_get(s->store, id);
+    if (series && series->count > 0) {
+        MetricView view = MetricStore_view(series);
+        t->count = view.count + view.history.count + view.merged;
+        t->first_step = view.first_step;
+        t->last_step = view.last_step;
+        t->last_value = view.last_value;
+        MetricView_release(&view);
+
+        // Its rows lie somewhere in what was read; any row read later is newer
+        t->first_offset = s->window_from;
+        t->last_offset = Storage_getMetricsOffset(s->handle);
+    }
+    MetricStore_drop(s->store, id);
+    s->states.modes[id] = KEY_TALLIED;
+}
+
+// Takes the set of keys the UI last reported on screen. While 'backlog' (may be NULL) is
+// loading its history, keys of it that are off screen stop being stored: they are demoted
+// to tallies, unless a sidecar already holds their points for free
+static void applyProjection(DataLoader* this, MetricsStream* backlog) {
+    pthread_mutex_lock(&this->lock);
+    if (this->projection_changed) {
+        int slots = KeyTable_count(this->keys);
+        for (int i = 0; i < this->projection_count; i++) {
+            if (this->projection[i] >= slots) slots = this->projection[i] + 1;
+        }
+        bool* visible = slots > this->visible_slots ? realloc(this->visible, (size_t)slots * sizeof(bool)) : this->visible;
+        if (visible) {
+            this->visible = visible;
+            if (slots > this->visible_slots) this->visible_slots = slots;
+            memset(visible, 0, (size_t)this->visible_slots * sizeof(bool));
+            for (int i = 0; i < this->projection_count; i++) {
+                if (this->projection[i] >= 0) visible[this->projection[i]] = true;
+            }
+            this->projected = true;
+            this->projection_changed = false;
+        }
+    }
+    pthread_mutex_unlock(&this->lock);
+
+    if (!backlog || !this->projected || backlog->sidecar) return;
+    int demoted = 0;
+    for (int id = 0; id < backlog->states.slots; id++) {
+        if (backlog->states.modes[id] != KEY_STORED || isVisible(this, id)) continue;
+        demoteKey(backlog, id);
+        demoted++;
+    }
+    if (demoted > 0) LOG_INFO("Tallying %d off-screen keys of the %s stream", demoted, streamLabel(backlog));
+}
+
+// Reads the points of every KEY_FETCHING key of a stream back in, from 'start' up to where
+// the stream has been read, then leaves the stream positioned where it was. Those keys are
+// stored from then on; if the read fails they stay tallied. Returns false on failure
+static bool fetchStream(DataLoader* this, MetricsStream* s, off_t start) {
+    MappingGuard guard;
+    if (sigsetjmp(guard.env, 1)) {
+        recoverStream(s);
+        return false;
+    }
+    Storage_armGuard(&guard);
+
+    off_t offset = Storage_getMetricsOffset(s->handle);
+    bool ok = Storage_seekMetrics(s->handle, start);
+
+    const char* data;
+    size_t len;
+    if (ok && Storage_peekMetrics(s->handle, &data, &len)) {
+        // Everything before the stream's offset ends in a newline
+        if (len > (size_t)(offset - start)) len = (size_t)(offset - start);
+        ok = parseSlice(this, s, data, len, start, true);
+    } else if (ok) {
+        MetricsChunk sink = streamSink(this, s);
+        sink.states = &sink.local;
+        sink.fetch = true;
+        MetricRecord* record = &this->record;
+        while (Storage_getMetricsOffset(s->handle) < offset) {
+            off_t row = Storage_getMetricsOffset(s->handle);
+            if (!Storage_readNextRecord(s->handle, record)) break;
+            addRecord(&sink, record, row);
+        }
+        ok = sink.dropped == 0;
+        freeStates(&sink.local);
+    }
+    if (!Storage_seekMetrics(s->handle, offset)) ok = false;
+
+    for (int id = 0; id < s->states.slots; id++) {
+        if (s->states.modes[id] != KEY_FETCHING) continue;
+        if (ok) {
+            s->states.modes[id] = KEY_STORED;
+            memset(&s->states.tallies[id], 0, sizeof(KeyTally));
+        } else {
+            MetricStore_drop(s->store, id);
+            s->states.modes[id] = KEY_TALLIED;
+        }
+    }
+    Storage_disarmGuard(&guard);
+    return ok;
+}
+
+// Fetches the history of the tallied keys of a stream that are on screen (or of all of
+// them, if 'all'). Returns true if any were fetched
+static bool fetchKeys(DataLoader* this, MetricsStream* s, bool all) {
+    if (!s->handle) return false;
+
+    int count = 0;
+    off_t start = -1;
+    for (int id = 0; id < s->states.slots; id++) {
+        if (s->states.modes[id] != KEY_TALLIED || (!all && !isVisible(this, id))) continue;
+        const KeyTally* t = &s->states.tallies[id];
+        if (t->count == 0) {
+            s->states.modes[id] = KEY_STORED;
+            continue;
+        }
+        s->states.modes[id] = KEY_FETCHING;
+
+        // Rows below the key's first step (or below the steps its window keeps) hold none
+        // of its points; the step index, where there is one, says where they end
+        int64_t from_step = t->first_step;
+        if (this->window > 0 && t->last_step - this->window + 1 > from_step) from_step = t->last_step - this->window + 1;
+        off_t from = Storage_findStep(s->handle, from_step);
+        if (from < t->first_offset || from > Storage_getMetricsOffset(s->handle)) from = t->first_offset;
+        if (start < 0 || from < start) start = from;
+        count++;
+    }
+    if (count == 0) return false;
+
+    if (start < s->window_from) start = s->window_from;
+    if (!fetchStream(this, s, start)) {
+        LOG_WARN("Could not read back the history of %d keys of the %s stream", count, streamLabel(s));
+        return false;
+    }
+    LOG_INFO("Read back the history of %d keys of the %s stream from byte %lld", count, streamLabel(s),
+             (long long)start);
+    return true;
+}
+
+// Loads a large unread backlog (cold open, or a rewritten file) newest rows first: a
+// TAIL_FIRST_BYTES slice read back from the end, then slices doubling in size towards the
+// start, publishing a snapshot after each so charts appear at once and fill in leftwards.
+// Older slices are appended after newer ones and put back in step order by the sort.
+// A windowed loader takes any backlog this way and stops at the first slice that reaches
+// back past the window (or, with a step index, right where the window starts), so opening
+// a long run costs about as much as the window does.
+// Returns true if anything was loaded; small backlogs and non-mmap handles are left to
+// the sequential reader
+static bool loadBacklog(DataLoader* this, MetricsStream* s) {
+    const char* data;
+    size_t len;
+    if (!Storage_peekMetrics(s->handle, &data, &len) || len == 0) return false;
+    if (this->window == 0 && len < PROGRESSIVE_MIN_BYTES) return false;
+
+    // Rows appended from here on go through the sequential reader as usual
+    off_t base = Storage_getMetricsOffset(s->handle);
+    Storage_seekMetrics(s->handle, base + (off_t)len);
+
+    // Rows without a step cannot be windowed; those backlogs are read in full
+    int64_t oldest_kept = INT64_MIN;
+    if (this->window > 0) {
+        int64_t newest = lastRowStep(this, data, len);
+        if (newest >= 0) oldest_kept = newest - this->window + 1;
+    }
+
+    // A step index saved by an earlier load says outright where the window starts, so
+    // nothing before it is read at all
+    size_t indexed_from = 0;
+    if (oldest_kept != INT64_MIN) {
+        off_t from = Storage_findStep(s->handle, oldest_kept);
+        if (from > base && from - base <= (off_t)len) indexed_from = (size_t)(from - base);
+    }
+
+    size_t end = len;
+    size_t slice = TAIL_FIRST_BYTES;
+    while (end > indexed_from) {
+        // Back up to the start of a line; the first slice's lines are the newest ones
+        size_t begin = end - indexed_from > slice ? end - slice : indexed_from;
+        while (begin > indexed_from && data[begin - 1] != '\n') begin--;
+
+        // Cards that went off screen since the last slice stop collecting this history
+        applyProjection(this, s);
+
+        if (!parseSlice(this, s, data + begin, end - begin, base + (off_t)begin, false)) {
+            // Start over from the beginning of the file rather than keep a partial merge
+            LOG_WARN("Metrics backlog load failed; falling back to sequential parsing");
+            resetSeries(s);
+            Storage_seekMetrics(s->handle, 0);
+            return true;
+        }
+        // Rows are mostly in step order, so a slice starting before the window means
+        // everything ahead of it is older still
+        if (oldest_kept != INT64_MIN) {
+            int64_t step = firstRowStep(this, data + begin, end - begin);
+            if (step >= 0 && step < oldest_kept) {
+                s->window_from = base + (off_t)begin;
+                LOG_INFO("Loaded the last %zu of %zu bytes of the %s stream for a %lld step window",
+                         len - begin, len, streamLabel(s), (long long)this->window);
+                return true;
+            }
+        }
+        end = begin;
+        slice *= 2;
+
+        // Quitting cuts the load short; whatever it left out is never shown anyway
+        if (atomic_load(&this->stopping)) return true;
+        if (end > indexed_from) publishMetrics(this, (int)((len - end) * 100 / (len - indexed_from)));
+    }
+    if (indexed_from > 0) {
+        s->window_from = base + (off_t)indexed_from;
+        LOG_INFO("Loaded the last %zu of %zu bytes of the %s stream for a %lld step window, as indexed",
+                 len - indexed_from, len, streamLabel(s), (long long)this->window);
+        return true;
+    }
+    LOG_INFO("Loaded %zu bytes of the %s stream's history newest first", len, streamLabel(s));
+    return true;
+}
+
+// Reads the rows newly appended to one stream into its store. Returns true if any series
+// changed
+static bool readStream(DataLoader* this, MetricsStream* s) {
+    bool changed = false;
+
+    // The metrics file may not exist yet when the run (or the namespace) has just started
+    if (!s->handle) {
+        s->handle = Storage_openMetricsStream(this->run_path, s->name, METRICS_READ_MMAP);
+        if (!s->handle) return false;
+
+        // A finished run reopens from its columnar sidecar and only parses the tail
+        changed = loadSidecar(this, s);
+    } else if (Storage_syncMetrics(s->handle)) {
+        // Truncated or replaced: everything we accumulated so far is stale
+        resetSeries(s);
+        changed = true;
+    }
+
+    // A large backlog (cold load, or a rewritten file) comes in newest first, in parallel
+    if (loadBacklog(this, s)) changed = true;
+
+    // Read only the rows appended since the last committed offset
+    MetricRecord* record = &this->record;
+    MetricsChunk sink = streamSink(this, s);
+    while (!atomic_load(&this->stopping)) {
+        off_t offset = Storage_getMetricsOffset(s->handle);
+        if (!Storage_readNextRecord(s->handle, record)) break;
+        if (addRecord(&sink, record, offset)) changed = true;
+    }
+    this->dropped += sink.dropped;
+
+    // Keep the step index in step with everything consumed, however it was parsed. A
+    // windowed load that skipped rows only extends an index that already covers them
+    Storage_updateStepIndex(s->handle, s->window_from);
+    return changed;
+}
+
+// Like readStream, with the stream's mapping guarded: a file that shrinks mid-read is
+// reloaded from scratch rather than taking the process down with SIGBUS
+static bool loadStream(DataLoader* this, MetricsStream* s) {
+    MappingGuard guard;
+    if (sigsetjmp(guard.env, 1)) {
+        recoverStream(s);
+        return true;
+    }
+    Storage_armGuard(&guard);
+    bool changed = readStream(this, s);
+    Storage_disarmGuard(&guard);
+    return changed;
+}
+
+// Opens a stream for every namespace streams.json lists that is not followed yet. The
+// writer only ever adds namespaces, so streams are never closed here
+static void syncStreams(DataLoader* this) {
+    const RunFiles* files = this->files;
+    if (Storage_sameFingerprint(&files->streams_print, &this->streams_print)) return;
+    this->streams_print = files->streams_print;
+
+    const StreamList* list = files->streams;
+    for (int i = 0; list && i < list->count; i++) {
+        bool known = false;
+        for (int j = 1; j < this->stream_count && !known; j++) {
+            known = strcmp(this->streams[j]->name, list->names[i]) == 0;
+        }
+        if (known) continue;
+        if (addStream(this, list->names[i])) {
+            LOG_INFO("Following metrics stream '%s'", list->names[i]);
+        } else {
+            LOG_WARN("Could not follow metrics stream '%s'", list->names[i]);
+        }
+    }
+}
+
+// Reads newly appended metrics from every stream. Each stream keeps its own read offset,
+// so a refresh only parses what was appended to each file since the last one: the system
+// stream's few rows no longer mean scanning past bulky training rows. Returns true if any
+// series changed
+static bool loadMetrics(DataLoader* this) {
+    bool changed = false;
+    int64_t dropped_before = this->dropped;
+
+    // Cards that scrolled into view get their history before anything new is read, while
+    // each stream's offset still marks the end of what its tallies cover
+    applyProjection(this, NULL);
+    for (int i = 0; i < this->stream_count && !atomic_load(&this->stopping); i++) {
+        if (fetchKeys(this, this->streams[i], false)) changed = true;
+    }
+
+    for (int i = 0; i < this->stream_count && !atomic_load(&this->stopping); i++) {
+        if (loadStream(this, this->streams[i])) changed = true;
+    }
+
+    // Never lose points quietly: a chart with a hole in it should at least say why
+    if (this->dropped > dropped_before) {
+        LOG_ERROR("Out of memory: %lld metric points could not be stored (%lld so far)",
+                  (long long)(this->dropped - dropped_before), (long long)this->dropped);
+    }
+    return changed;
+}
+
+// Picks up everything that changed on disk and publishes it. The run files go out first,
+// so the summary is on screen while a large history is still loading
+static void loadAndPublish(DataLoader* this) {
+    DataSnapshot* files = calloc(1, sizeof(DataSnapshot));
+    if (files) {
+        snapshotRunFiles(this, files);
+        if (files->files_changed) {
+            publishSnapshot(this, files);
+        } else {
+            DataSnapshot_delete(files);
+        }
+    }
+
+    syncStreams(this);
+
+    if (!this->manifest_checked) {
+        this->manifest_checked = true;
+        loadManifest(this);
+    }
+    if (loadMetrics(this)) publishMetrics(this, 100);
+}
+
+// Loader thread: sleeps until asked (or until the poll interval passes), then loads and
+// publishes whatever changed
+static void* loaderMain(void* arg) {
+    DataLoader* this = (DataLoader*)arg;
+
+    pthread_mutex_lock(&this->lock);
+    while (!atomic_load(&this->stopping)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        double whole = (double)(long)this->poll_interval;
+        deadline.tv_sec += (time_t)whole;
+        deadline.tv_nsec += (long)((this->poll_interval - whole) * 1e9);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // An ended run will not change again; only explicit requests (projection fetches)
+        // wake the loader then
+        while (!this->requested && !atomic_load(&this->stopping)) {
+            if (this->poll_interval <= 0.0 || this->finished) {
+                pthread_cond_wait(&this->wake, &this->lock);
+            } else if (pthread_cond_timedwait(&this->wake, &this->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (atomic_load(&this->stopping)) break;
+        this->requested = false;
+        pthread_mutex_unlock(&this->lock);
+
+        loadAndPublish(this);
+
+        // An ended run will not grow again: cache its columns for the next open now, in full
+        if (this->finished) saveCaches(this, true);
+
+        pthread_mutex_lock(&this->lock);
+    }
+    pthread_mutex_unlock(&this->lock);
+    return NULL;
+}
+
+// Keeps only the last 'steps' steps of every series, summarizing the points it drops, and
+// reads a cold backlog back from its end only as far as that window reaches (rows it never
+// reads are not in the summary either). Zero keeps everything. Must be set before the
+// loader is started
+void DataLoader_setWindow(DataLoader* this, int64_t steps) {
+    if (!this || this->running) return;
+    this->window = steps > 0 ? steps : 0;
+}
+
+// Keeps every stream's series within 'bytes' together, compressing settled points and then
+// downsampling the oldest points of the largest series to min/max pairs as needed. A
+// downsampled stream writes no sidecar. Zero sets no limit. Must be set before the loader is
+// started, and not together with a window
+void DataLoader_setMemoryBudget(DataLoader* this, size_t bytes) {
+    if (!this || this->running) return;
+    this->max_memory = bytes;
+}
+
+// Starts the loader thread. It loads whenever DataLoader_request is called, and also every
+// 'poll_interval' seconds if that is positive, until the run has ended. Returns false if it
+// could not be started
+bool DataLoader_start(DataLoader* this, double poll_interval) {
+    if (!this || this->running) return false;
+
+#ifdef __linux__
+    this->notify_read = this->notify_write = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    if (this->notify_read < 0) {
+        int fds[2];
+        if (pipe(fds) != 0) return false;
+        for (int i = 0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        this->notify_read = fds[0];
+        this->notify_write = fds[1];
+    }
+
+    this->poll_interval = poll_interval;
+    atomic_store(&this->stopping, false);
+    LOG_INFO("Scanning metrics rows with the %s JSON scanner", JsonScan_implementation());
+
+    // Resizes are the UI thread's to take through its signalfd. The loader (and the parse
+    // workers it starts, which inherit its mask) keep SIGWINCH blocked, or the kernel may
+    // hand the signal to one of them and the UI's poll() never wakes
+    sigset_t resize, previous;
+    sigemptyset(&resize);
+    sigaddset(&resize, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &resize, &previous);
+    int failed = pthread_create(&this->thread, NULL, loaderMain, this);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (failed) {
+        LOG_ERROR("Could not start the metrics loader thread");
+        return false;
+    }
+    this->running = true;
+    return true;
+}
+
+// Stops the loader thread, waiting for a load in progress to finish
+void DataLoader_stop(DataLoader* this) {
+    if (!this || !this->running) return;
+
+    pthread_mutex_lock(&this->lock);
+    atomic_store(&this->stopping, true);
+    pthread_cond_signal(&this->wake);
+    pthread_mutex_unlock(&this->lock);
+
+    pthread_join(this->thread, NULL);
+    this->running = false;
+}
+
+// Tells the loader which keys are on screen. Once told, it stores the points only of those
+// keys (and of keys whose history it already holds); for the others it keeps a count and
+// the last value. A key that comes on screen has its history read back on the next load,
+// which this asks for. Never blocks on a load
+void DataLoader_setProjection(DataLoader* this, const int* ids, int count) {
+    if (!this || count < 0) return;
+    int* projection = malloc((count ? count : 1) * sizeof(int));
+    if (!projection) return;
+    if (count > 0) memcpy(projection, ids, (size_t)count * sizeof(int));
+
+    pthread_mutex_lock(&this->lock);
+    free(this->projection);
+    this->projection = projection;
+    this->projection_count = count;
+    this->projection_changed = true;
+    this->requested = true;
+    pthread_cond_signal(&this->wake);
+    pthread_mutex_unlock(&this->lock);
+}
+
+// Asks the loader thread to pick up whatever changed on disk. Never blocks on a load
+void DataLoader_request(DataLoader* this) {
+    if (!this) return;
+    pthread_mutex_lock(&this->lock);
+    this->requested = true;
+    pthread_cond_signal(&this->wake);
+    pthread_mutex_unlock(&this->lock);
+}
+
+// Returns a descriptor that becomes readable when a snapshot is published
+int DataLoader_getNotifyFd(const DataLoader* this) {
+    return this ? this->notify_read : -1;
+}
+
+// Consumes pending notifications. Returns true if a snapshot is waiting to be taken
+bool DataLoader_drainNotify(DataLoader* this) {
+    if (!this) return false;
+    uint64_t buf[8];
+    while (this->notify_read >= 0 && read(this->notify_read, buf, sizeof(buf)) > 0) {}
+    return atomic_load(&this->published) != NULL;
+}
+
+// Takes the latest published snapshot (older ones not yet taken are folded into it),
+// or returns NULL if there is none. Free it with DataSnapshot_delete
+DataSnapshot* DataLoader_takeSnapshot(DataLoader* this) {
+    if (!this) return NULL;
+    return atomic_exchange(&this->published, NULL);
+}
+
+// Rebuilds the metrics and system panels from a snapshot whose metrics changed
+void DataSnapshot_populate(const DataSnapshot* snapshot, Panel* metricsPanel, Panel* systemPanel) {
+    if (!snapshot || !snapshot->metrics_changed) return;
 
     // Clear existing panel contents
     if (metricsPanel) Panel_clear(metricsPanel);
     if (systemPanel) Panel_clear(systemPanel);
 
-    // Populate panels with collected metrics
-    for (int i = 0; i < series_count; i++) {
-        MetricSeries* s = &all_series[i];
-        
-        // Skip empty or invalid series
-        if (s->count == 0 || !s->key || !s->values) continue;
+    // Populate panels with collected metrics, in order of first appearance
+    for (int i = 0; i < snapshot->metric_count; i++) {
+        const SnapshotMetric* m = &snapshot->metrics[i];
 
-        // Get the most recent value from the series
-        float current = s->values[s->count - 1];
+        // The value at the highest step
+        double current = m->view.last_value;
 
         // Route system metrics to system panel with appropriate formatting
-        if (strncmp(s->key, "system/", 7) == 0) {
+        if (m->is_system) {
             if (systemPanel) {
-                char* display_name = s->key + 7;  // Strip "system/" prefix
                 char val_str[64];
                 
-                // Format value based on metric type heuristics
-                if (strstr(display_name, "percent") || strstr(display_name, "util") || strstr(display_name, "load")) {
-                     snprintf(val_str, sizeof(val_str), "%.1f%%", current);
-                } else if (strstr(display_name, "gb") || strstr(display_name, "ram")) {
-                     snprintf(val_str, sizeof(val_str), "%.2fGB", current);
-                } else if (strstr(display_name, "temp")) {
-                     snprintf(val_str, sizeof(val_str), "%.0f°C", current);
-                } else {
-                     snprintf(val_str, sizeof(val_str), "%.4f", current);
+                // Format value based on the unit derived once when the key was interned
+                switch (m->unit) {
+                    case KEY_UNIT_PERCENT: snprintf(val_str, sizeof(val_str), "%.1f%%", current); break;
+                    case KEY_UNIT_GB:      snprintf(val_str, sizeof(val_str), "%.2fGB", current); break;
+                    case KEY_UNIT_CELSIUS: snprintf(val_str, sizeof(val_str), "%.0f°C", current); break;
+                    default:               snprintf(val_str, sizeof(val_str), "%.4f", current); break;
                 }
 
                 char buffer[256];
-                snprintf(buffer, sizeof(buffer), "%s\t%s", display_name, val_str);
+                snprintf(buffer, sizeof(buffer), "%s\t%s", m->display_name, val_str);
                 Panel_addItem(systemPanel, buffer, NULL);
             }
         } else {
             // Route regular metrics to metrics panel with full time series data
             if (metricsPanel) {
-                MetricsPanel_addMetric(metricsPanel, s->key, current, s->values, s->count);
+                MetricsPanel_addMetric(metricsPanel, m->id, m->name, &m->view);
             }
         }
     }
-    
-    // Clean up all allocated series data
-    freeAllSeries(all_series, series_count);
-}
\ No newline at end of file
+}
+
+// Releases a snapshot's views and frees the run file objects it still owns
+void DataSnapshot_delete(DataSnapshot* snapshot) {
+    if (!snapshot) return;
+    for (int i = 0; i < snapshot->metric_count; i++) MetricView_release(&snapshot->metrics[i].view);
+    free(snapshot->metrics);
+    Storage_freeRunConfig(snapshot->config);
+    Storage_freeRunMetadata(snapshot->meta);
+    Storage_freeRunSummary(snapshot->summary);
+    free(snapshot);
+}
@@ -2,8 +2,105 @@
 #define EXPML_DATALOADER_H
 
 #include "Panel.h"
+#include "Storage.h"
+#include "KeyTable.h"
+#include "MetricStore.h"
 
-// Loads metrics and system data from a run directory and populates the corresponding panels
-void DataLoader_loadMetrics(const char* run_path, Panel* metricsPanel, Panel* systemPanel);
+#include <stdbool.h>
+
+// Which run files a snapshot carries a new version of
+#define SNAPSHOT_CONFIG   0x1
+#define SNAPSHOT_METADATA 0x2
+#define SNAPSHOT_SUMMARY  0x4
+
+typedef struct DataLoader_ DataLoader;
+
+// One non-empty series as it stood when the snapshot was taken. The strings belong to the
+// loader's key table and stay valid until the loader is deleted
+typedef struct SnapshotMetric_ {
+    int id;
+    const char* name;
+    const char* display_name;
+    bool is_system;
+    KeyUnit unit;
+    MetricView view;
+    int64_t tallied;           // Points counted but not kept (the key is off screen); 'view' is then empty
+} SnapshotMetric;
+
+// Everything one load produced, built by the loader thread and never changed once
+// published. The taker owns it, including the run file objects it carries
+typedef struct DataSnapshot_ {
+    bool metrics_changed;      // If false, 'metrics' is empty and the panels stay as they are
+    SnapshotMetric* metrics;   // In key id order
+    int metric_count;
+    int load_percent;          // Share of a newest-first history load done so far; 100 once complete
+    size_t memory_used;        // Bytes the series take up; measured only under a memory budget
+    double downsample_ratio;   // Points read per point kept, under a memory budget
+    int files_changed;         // SNAPSHOT_* bits; NULL below then means the file is gone
+    RunConfig* config;
+    RunMetadata* meta;
+    RunSummary* summary;
+} DataSnapshot;
+
+// Creates a loader that incrementally follows the metrics and run files of a run directory,
+// including the namespace streams the writer lists in streams.json as they appear
+DataLoader* DataLoader_new(const char* run_path);
+
+// Stops the loader thread and frees the loader, its open metrics handle, all accumulated
+// series and any snapshot not yet taken
+void DataLoader_delete(DataLoader* this);
+
+// Keeps only the last 'steps' steps of every series, summarizing the points it drops, and
+// reads a cold backlog back from its end only as far as that window reaches (rows it never
+// reads are not in the summary either). Zero keeps everything. Must be set before the
+// loader is started
+void DataLoader_setWindow(DataLoader* this, int64_t steps);
+
+// Keeps every stream's series within 'bytes' together, compressing settled points and then
+// downsampling the oldest points of the largest series to min/max pairs as needed. A
+// downsampled stream writes no sidecar. Zero sets no limit. Must be set before the loader is
+// started, and not together with a window
+void DataLoader_setMemoryBudget(DataLoader* this, size_t bytes);
+
+// Starts the loader thread. It loads whenever DataLoader_request is called, and also every
+// 'poll_interval' seconds if that is positive, until the run has ended. Returns false if it
+// could not be started
+bool DataLoader_start(DataLoader* this, double poll_interval);
+
+// Stops the loader thread, waiting for a load in progress to finish
+void DataLoader_stop(DataLoader* this);
+
+// Tells the loader which keys are on screen. Once told, it stores the points only of those
+// keys (and of keys whose history it already holds); for the others it keeps a count and
+// the last value. A key that comes on screen has its history read back on the next load,
+// which this asks for. Never blocks on a load
+void DataLoader_setProjection(DataLoader* this, const int* ids, int count);
+
+// Asks the loader thread to pick up whatever changed on disk. Never blocks on a load
+void DataLoader_request(DataLoader* this);
+
+// Returns a descriptor that becomes readable when a snapshot is published
+int DataLoader_getNotifyFd(const DataLoader* this);
+
+// Consumes pending notifications. Returns true if a snapshot is waiting to be taken
+bool DataLoader_drainNotify(DataLoader* this);
+
+// Takes the latest published snapshot (older ones not yet taken are folded into it),
+// or returns NULL if there is none. Free it with DataSnapshot_delete
+DataSnapshot* DataLoader_takeSnapshot(DataLoader* this);
+
+// Rebuilds the metrics and system panels from a snapshot whose metrics changed
+void DataSnapshot_populate(const DataSnapshot* snapshot, Panel* metricsPanel, Panel* systemPanel);
+
+// Releases a snapshot's views and frees the run file objects it still owns
+void DataSnapshot_delete(DataSnapshot* snapshot);
+
+// Writes each stream's columnar sidecar (metrics.expc, metrics.<name>.expc) and step index
+// so the next open can skip parsing. Does nothing for a stream if both already cover
+// everything read, and a windowed loader, holding only part of the history, writes no
+// sidecar; nor does a stream holding tallied keys or downsampled series. Must not run while
+// the loader thread is: the thread saves on its own once the run has ended, reading tallied
+// keys back for it. Returns true if any sidecar was written
+bool DataLoader_saveCache(DataLoader* this);
 
 #endif
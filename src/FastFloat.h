@@ -0,0 +1,11 @@
+#ifndef EXPML_FASTFLOAT_H
+#define EXPML_FASTFLOAT_H
+
+// Parses a JSON number at the start of [p, end) into the nearest double, exactly as strtod
+// would round it, but independent of the current locale and without needing a terminator.
+// Most inputs take the Clinger or Eisel-Lemire fast path; the rare ambiguous cases (more
+// than 19 significant digits, subnormals, exact halfway ties) are handed to strtod.
+// Returns a pointer just past the number, or NULL if [p, end) does not start with one
+const char* FastFloat_parse(const char* p, const char* end, double* out);
+
+#endif
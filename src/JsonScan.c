@@ -0,0 +1,190 @@
+#include "JsonScan.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define JSONSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef size_t (*JsonScan_IndexFn)(const char* buf, size_t len, uint32_t* out, bool* has_escape);
+
+// --- Scalar implementation (reference and fallback) ---
+
+static size_t indexScalar(const char* buf, size_t len, uint32_t* out, bool* has_escape) {
+    size_t n = 0;
+    bool in_string = false;
+    bool escape = false;
+
+    for (size_t i = 0; i < len; i++) {
+        switch (buf[i]) {
+            case '"':
+                in_string = !in_string;
+                out[n++] = (uint32_t)i;
+                break;
+            case '\\':
+                escape = true;
+                break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                if (!in_string) out[n++] = (uint32_t)i;
+                break;
+            default:
+                break;
+        }
+    }
+    *has_escape = escape;
+    return n;
+}
+
+#ifdef JSONSCAN_X86
+
+// Per 64-byte block classification: one bit per byte
+typedef struct BlockMasks_ {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;           // { } [ ] : ,
+} BlockMasks;
+
+// Turns each quote bit into a run of ones covering the string it opens (inclusive of the
+// opening quote, exclusive of the closing one). 'carry' is all-ones if the previous block
+// ended inside a string
+static inline uint64_t stringMask(uint64_t quote, uint64_t* carry) {
+    uint64_t m = quote;
+    m ^= m << 1;
+    m ^= m << 2;
+    m ^= m << 4;
+    m ^= m << 8;
+    m ^= m << 16;
+    m ^= m << 32;
+    m ^= *carry;
+    *carry = (uint64_t)((int64_t)m >> 63);
+    return m;
+}
+
+// Appends the offsets of all set bits of 'mask' to 'out'
+static inline size_t flattenBits(uint64_t mask, uint32_t base, uint32_t* out, size_t n) {
+    while (mask) {
+        out[n++] = base + (uint32_t)__builtin_ctzll(mask);
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+// Shared driver: classifies whole 64-byte blocks with 'classify' and pads the tail
+#define JSONSCAN_DRIVER(name, classify)                                              \
+    static size_t name(const char* buf, size_t len, uint32_t* out, bool* has_escape) { \
+        size_t n = 0;                                                                \
+        uint64_t carry = 0;                                                          \
+        uint64_t backslashes = 0;                                                    \
+        size_t i = 0;                                                                \
+        for (; i + 64 <= len; i += 64) {                                             \
+            BlockMasks b = classify(buf + i);                                        \
+            uint64_t in_string = stringMask(b.quote, &carry);                        \
+            backslashes |= b.backslash;                                              \
+            n = flattenBits((b.op & ~in_string) | b.quote, (uint32_t)i, out, n);     \
+        }                                                                            \
+        if (i < len) {                                                               \
+            char tail[64];                                                           \
+            memset(tail, ' ', sizeof(tail));                                         \
+            memcpy(tail, buf + i, len - i);                                          \
+            BlockMasks b = classify(tail);                                           \
+            uint64_t in_string = stringMask(b.quote, &carry);                        \
+            backslashes |= b.backslash;                                              \
+            n = flattenBits((b.op & ~in_string) | b.quote, (uint32_t)i, out, n);     \
+        }                                                                            \
+        *has_escape = backslashes != 0;                                              \
+        return n;                                                                    \
+    }
+
+// --- SSE2 (x86-64 baseline) ---
+
+static inline uint64_t classify16(__m128i v, char c) {
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static inline uint64_t classifyOps16(__m128i v) {
+    // '{' '}' and '[' ']' differ from each other only in bit 0x20
+    __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i ops = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                               _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+    ops = _mm_or_si128(ops, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+    ops = _mm_or_si128(ops, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    return (uint64_t)(uint16_t)_mm_movemask_epi8(ops);
+}
+
+static inline BlockMasks classifySSE2(const char* p) {
+    BlockMasks b = {0, 0, 0};
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + k * 16));
+        b.quote     |= classify16(v, '"') << (k * 16);
+        b.backslash |= classify16(v, '\\') << (k * 16);
+        b.op        |= classifyOps16(v) << (k * 16);
+    }
+    return b;
+}
+
+JSONSCAN_DRIVER(indexSSE2, classifySSE2)
+
+// --- AVX2 ---
+
+__attribute__((target("avx2")))
+static inline uint64_t classify32(__m256i v, char c) {
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t classifyOps32(__m256i v) {
+    __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i ops = _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                                  _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+    ops = _mm256_or_si256(ops, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    ops = _mm256_or_si256(ops, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+    return (uint64_t)(uint32_t)_mm256_movemask_epi8(ops);
+}
+
+__attribute__((target("avx2")))
+static inline BlockMasks classifyAVX2(const char* p) {
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    BlockMasks b;
+    b.quote     = classify32(lo, '"')  | (classify32(hi, '"') << 32);
+    b.backslash = classify32(lo, '\\') | (classify32(hi, '\\') << 32);
+    b.op        = classifyOps32(lo)    | (classifyOps32(hi) << 32);
+    return b;
+}
+
+__attribute__((target("avx2")))
+JSONSCAN_DRIVER(indexAVX2, classifyAVX2)
+
+#endif // JSONSCAN_X86
+
+// --- Runtime dispatch ---
+
+static JsonScan_IndexFn g_index = indexScalar;
+static const char* g_name = "scalar";
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+// Picks the widest implementation the running CPU supports
+static void selectImplementation(void) {
+#ifdef JSONSCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        g_index = indexAVX2;
+        g_name = "avx2";
+    } else {
+        g_index = indexSSE2;
+        g_name = "sse2";
+    }
+#endif
+}
+
+size_t JsonScan_index(const char* buf, size_t len, uint32_t* out, bool* has_escape) {
+    pthread_once(&g_once, selectImplementation);
+    return g_index(buf, len, out, has_escape);
+}
+
+const char* JsonScan_implementation(void) {
+    pthread_once(&g_once, selectImplementation);
+    return g_name;
+}
@@ -0,0 +1,19 @@
+#ifndef EXPML_JSONSCAN_H
+#define EXPML_JSONSCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Builds a structural index of a JSON text: the offsets of every quote, plus every
+// '{' '}' '[' ']' ':' ',' that lies outside a string, in ascending order. 'out' must
+// hold at least 'len' entries. Backslashes are not interpreted; if any are present,
+// *has_escape is set and the caller should not trust the string boundaries.
+// The SSE2/AVX2/scalar implementation is picked once at runtime from the CPU features.
+// Returns the number of offsets written
+size_t JsonScan_index(const char* buf, size_t len, uint32_t* out, bool* has_escape);
+
+// Returns the name of the implementation selected for this CPU ("avx2", "sse2" or "scalar")
+const char* JsonScan_implementation(void);
+
+#endif
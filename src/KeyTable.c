@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "KeyTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYTABLE_INITIAL_SLOTS 256   // Power of two; kept at most half full
+#define KEYTABLE_INITIAL_KEYS 64
+
+struct KeyTable_ {
+    KeyInfo* keys;         // Dense array indexed by id
+    int count;
+    int capacity;
+    int32_t* slots;        // Open-addressing table of id + 1 (0 = empty), linear probing
+    size_t slot_count;
+};
+
+// 32-bit FNV-1a
+static uint32_t hashKey(const char* key, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Case-sensitive substring search within a key that is not NUL-terminated
+static bool keyContains(const char* key, size_t len, const char* needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(key + i, needle, n) == 0) return true;
+    }
+    return false;
+}
+
+// Derives routing and display facts once per key instead of on every refresh
+static void classifyKey(KeyInfo* k) {
+    k->is_internal = (k->len > 0 && k->name[0] == '_');
+    k->is_system = (k->len >= 7 && memcmp(k->name, "system/", 7) == 0);
+    k->display_name = k->is_system ? k->name + 7 : k->name;
+
+    const char* d = k->display_name;
+    size_t d_len = k->len - (size_t)(d - k->name);
+    if (keyContains(d, d_len, "percent") || keyContains(d, d_len, "util") || keyContains(d, d_len, "load")) {
+        k->unit = KEY_UNIT_PERCENT;
+    } else if (keyContains(d, d_len, "gb") || keyContains(d, d_len, "ram")) {
+        k->unit = KEY_UNIT_GB;
+    } else if (keyContains(d, d_len, "temp")) {
+        k->unit = KEY_UNIT_CELSIUS;
+    } else {
+        k->unit = KEY_UNIT_PLAIN;
+    }
+}
+
+// Creates an empty key table
+KeyTable* KeyTable_new(void) {
+    KeyTable* this = calloc(1, sizeof(KeyTable));
+    if (!this) return NULL;
+
+    this->keys = malloc(KEYTABLE_INITIAL_KEYS * sizeof(KeyInfo));
+    this->slots = calloc(KEYTABLE_INITIAL_SLOTS, sizeof(int32_t));
+    if (!this->keys || !this->slots) {
+        free(this->keys);
+        free(this->slots);
+        free(this);
+        return NULL;
+    }
+    this->capacity = KEYTABLE_INITIAL_KEYS;
+    this->slot_count = KEYTABLE_INITIAL_SLOTS;
+    return this;
+}
+
+// Frees the table and every interned key
+void KeyTable_delete(KeyTable* this) {
+    if (!this) return;
+    for (int i = 0; i < this->count; i++) {
+        free(this->keys[i].name);
+    }
+    free(this->keys);
+    free(this->slots);
+    free(this);
+}
+
+// Returns the slot holding the key, or the empty slot where it would be inserted
+static size_t probe(const KeyTable* this, const char* key, size_t len, uint32_t hash) {
+    size_t mask = this->slot_count - 1;
+    size_t i = hash & mask;
+    for (;;) {
+        int32_t slot = this->slots[i];
+        if (slot == 0) return i;
+
+        const KeyInfo* k = &this->keys[slot - 1];
+        if (k->hash == hash && k->len == len && memcmp(k->name, key, len) == 0) return i;
+        i = (i + 1) & mask;
+    }
+}
+
+// Doubles the slot array and reinserts every id
+static bool growSlots(KeyTable* this) {
+    size_t new_count = this->slot_count * 2;
+    int32_t* new_slots = calloc(new_count, sizeof(int32_t));
+    if (!new_slots) return false;
+
+    size_t mask = new_count - 1;
+    for (int id = 0; id < this->count; id++) {
+        size_t i = this->keys[id].hash & mask;
+        while (new_slots[i] != 0) i = (i + 1) & mask;
+        new_slots[i] = id + 1;
+    }
+
+    free(this->slots);
+    this->slots = new_slots;
+    this->slot_count = new_count;
+    return true;
+}
+
+// Returns the id of the key, interning it on first sight. Ids are dense, start at 0,
+// follow first appearance and never change for the lifetime of the table. -1 on failure
+int KeyTable_intern(KeyTable* this, const char* key, size_t len) {
+    if (!this || !key) return -1;
+
+    uint32_t hash = hashKey(key, len);
+    size_t i = probe(this, key, len, hash);
+    if (this->slots[i] != 0) return this->slots[i] - 1;
+
+    // Keep the load factor at or below one half so probe chains stay short
+    if ((size_t)(this->count + 1) * 2 > this->slot_count) {
+        if (!growSlots(this)) return -1;
+        i = probe(this, key, len, hash);
+    }
+
+    if (this->count >= this->capacity) {
+        int new_capacity = this->capacity * 2;
+        KeyInfo* new_keys = realloc(this->keys, (size_t)new_capacity * sizeof(KeyInfo));
+        if (!new_keys) return -1;
+        this->keys = new_keys;
+        this->capacity = new_capacity;
+    }
+
+    KeyInfo* k = &this->keys[this->count];
+    k->name = strndup(key, len);
+    if (!k->name) return -1;
+    k->len = len;
+    k->hash = hash;
+    classifyKey(k);
+
+    this->slots[i] = this->count + 1;
+    return this->count++;
+}
+
+// Returns the id of an already interned key, or -1
+int KeyTable_find(const KeyTable* this, const char* key, size_t len) {
+    if (!this || !key) return -1;
+    size_t i = probe(this, key, len, hashKey(key, len));
+    return this->slots[i] - 1;
+}
+
+// Returns the entry for an id, or NULL if out of range
+const KeyInfo* KeyTable_get(const KeyTable* this, int id) {
+    if (!this || id < 0 || id >= this->count) return NULL;
+    return &this->keys[id];
+}
+
+// Returns the number of interned keys
+int KeyTable_count(const KeyTable* this) {
+    return this ? this->count : 0;
+}
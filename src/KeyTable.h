@@ -0,0 +1,49 @@
+#ifndef EXPML_KEYTABLE_H
+#define EXPML_KEYTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// How a metric value should be displayed, derived once from its key name
+typedef enum KeyUnit_ {
+    KEY_UNIT_PLAIN,
+    KEY_UNIT_PERCENT,      // "percent", "util", "load"
+    KEY_UNIT_GB,           // "gb", "ram"
+    KEY_UNIT_CELSIUS,      // "temp"
+} KeyUnit;
+
+// An interned metric key plus the facts derived from its name
+typedef struct KeyInfo_ {
+    char* name;
+    size_t len;
+    uint32_t hash;
+    bool is_internal;          // Bookkeeping field such as "_step" or "_runtime"
+    bool is_system;            // "system/..." key routed to the System panel
+    const char* display_name;  // Name without the "system/" prefix
+    KeyUnit unit;
+} KeyInfo;
+
+typedef struct KeyTable_ KeyTable;
+
+// Creates an empty key table
+KeyTable* KeyTable_new(void);
+
+// Frees the table and every interned key
+void KeyTable_delete(KeyTable* this);
+
+// Returns the id of the key, interning it on first sight. Ids are dense, start at 0,
+// follow first appearance and never change for the lifetime of the table. -1 on failure
+int KeyTable_intern(KeyTable* this, const char* key, size_t len);
+
+// Returns the id of an already interned key, or -1
+int KeyTable_find(const KeyTable* this, const char* key, size_t len);
+
+// Returns the entry for an id, or NULL if out of range. The pointer is invalidated by the
+// next KeyTable_intern; the name and display_name strings it points to are not
+const KeyInfo* KeyTable_get(const KeyTable* this, int id);
+
+// Returns the number of interned keys
+int KeyTable_count(const KeyTable* this);
+
+#endif
@@ -0,0 +1,745 @@
+#include "MetricStore.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERIES_INITIAL_CAPACITY 1024
+#define STORE_INITIAL_SLOTS 64
+
+struct MetricStore_ {
+    MetricSeries* series;  // Indexed by key id
+    int count;
+    int capacity;
+};
+
+// Creates an empty store
+MetricStore* MetricStore_new(void) {
+    return calloc(1, sizeof(MetricStore));
+}
+
+// Allocates unshared heap columns with room for 'capacity' uncompressed points, taking a
+// reference on each of the first 'block_count' sealed blocks
+static SeriesColumns* newColumns(int64_t capacity, SeriesBlock* const* blocks, int64_t block_count) {
+    SeriesColumns* c = calloc(1, sizeof(SeriesColumns));
+    if (!c) return NULL;
+    if (capacity < 1) capacity = 1;
+
+    c->refcount = 1;
+    c->steps = malloc((size_t)capacity * sizeof(int64_t));
+    c->timestamps = malloc((size_t)capacity * sizeof(double));
+    c->values = malloc((size_t)capacity * sizeof(double));
+    if (block_count > 0) c->blocks = malloc((size_t)block_count * sizeof(SeriesBlock*));
+    if (!c->steps || !c->timestamps || !c->values || (block_count > 0 && !c->blocks)) {
+        free(c->steps);
+        free(c->timestamps);
+        free(c->values);
+        free(c->blocks);
+        free(c);
+        return NULL;
+    }
+
+    for (int64_t i = 0; i < block_count; i++) c->blocks[i] = SeriesBlock_retain(blocks[i]);
+    c->block_count = block_count;
+    c->block_capacity = block_count;
+    return c;
+}
+
+// Drops one reference, freeing the columns with the last one
+static void releaseColumns(SeriesColumns* c) {
+    if (!c || --c->refcount > 0) return;
+    for (int64_t i = 0; i < c->block_count; i++) SeriesBlock_release(c->blocks[i]);
+    free(c->blocks);
+    if (!c->mapped) {
+        free(c->steps);
+        free(c->timestamps);
+        free(c->values);
+    }
+    free(c);
+}
+
+// Resizes unshared heap columns to hold 'capacity' uncompressed points. On failure each
+// array keeps whichever of its old or new size it ended up with
+static bool resizeColumns(SeriesColumns* c, int64_t capacity) {
+    int64_t* new_steps = realloc(c->steps, (size_t)capacity * sizeof(int64_t));
+    if (new_steps) c->steps = new_steps;
+    double* new_timestamps = realloc(c->timestamps, (size_t)capacity * sizeof(double));
+    if (new_timestamps) c->timestamps = new_timestamps;
+    double* new_values = realloc(c->values, (size_t)capacity * sizeof(double));
+    if (new_values) c->values = new_values;
+    return new_steps && new_timestamps && new_values;
+}
+
+// Makes room for 'count' sealed blocks in unshared columns
+static bool reserveBlocks(SeriesColumns* c, int64_t count) {
+    if (count <= c->block_capacity) return true;
+
+    int64_t new_capacity = c->block_capacity > 0 ? c->block_capacity : 16;
+    while (new_capacity < count) new_capacity *= 2;
+    SeriesBlock** list = realloc(c->blocks, (size_t)new_capacity * sizeof(SeriesBlock*));
+    if (!list) return false;
+
+    c->blocks = list;
+    c->block_capacity = new_capacity;
+    return true;
+}
+
+// Makes 'c' the series' columns, taking over the caller's reference
+static void bindColumns(MetricSeries* s, SeriesColumns* c) {
+    s->columns = c;
+    s->head = 0;
+    s->steps = c->steps;
+    s->timestamps = c->timestamps;
+    s->values = c->values;
+}
+
+// Empties the series' value and timestamp ranges
+static void resetRanges(MetricSeries* s) {
+    s->min_value = INFINITY;
+    s->max_value = -INFINITY;
+    s->min_timestamp = INFINITY;
+    s->max_timestamp = -INFINITY;
+}
+
+// Widens the series' ranges to include a point (NaN and infinities are not plotted)
+static void trackRanges(MetricSeries* s, double timestamp, double value) {
+    if (isfinite(value)) {
+        if (value < s->min_value) s->min_value = value;
+        if (value > s->max_value) s->max_value = value;
+    }
+    if (isfinite(timestamp)) {
+        if (timestamp < s->min_timestamp) s->min_timestamp = timestamp;
+        if (timestamp > s->max_timestamp) s->max_timestamp = timestamp;
+    }
+}
+
+// Drops the series' reference on its columns and empties the slot
+static void freeSeries(MetricSeries* s) {
+    releaseColumns(s->columns);
+    memset(s, 0, sizeof(MetricSeries));
+}
+
+// Frees the store and every series it owns (mapped columns are left to their mapping)
+void MetricStore_delete(MetricStore* this) {
+    if (!this) return;
+    MetricStore_clear(this);
+    free(this->series);
+    free(this);
+}
+
+// Drops every series; slots for known ids stay allocated but empty
+void MetricStore_clear(MetricStore* this) {
+    if (!this) return;
+    for (int i = 0; i < this->count; i++) freeSeries(&this->series[i]);
+}
+
+// Drops the series for 'id', if any; views taken of it keep their columns
+void MetricStore_drop(MetricStore* this, int id) {
+    if (!this || id < 0 || id >= this->count) return;
+    freeSeries(&this->series[id]);
+}
+
+// Returns the number of id slots, i.e. one past the highest id ever used
+int MetricStore_count(const MetricStore* this) {
+    return this ? this->count : 0;
+}
+
+// Returns the series for 'id', or NULL if nothing was ever stored under it
+const MetricSeries* MetricStore_get(const MetricStore* this, int id) {
+    if (!this || id < 0 || id >= this->count || !this->series[id].columns) return NULL;
+    return &this->series[id];
+}
+
+// Returns the (possibly empty) slot for 'id', growing the slot array on demand
+static MetricSeries* slotFor(MetricStore* this, int id) {
+    if (id < 0) return NULL;
+
+    if (id >= this->capacity) {
+        int new_capacity = this->capacity ? this->capacity : STORE_INITIAL_SLOTS;
+        while (new_capacity <= id) new_capacity *= 2;
+        MetricSeries* list = realloc(this->series, new_capacity * sizeof(MetricSeries));
+        if (!list) return NULL;
+
+        memset(&list[this->capacity], 0, (new_capacity - this->capacity) * sizeof(MetricSeries));
+        this->series = list;
+        this->capacity = new_capacity;
+    }
+    if (id >= this->count) this->count = id + 1;
+    return &this->series[id];
+}
+
+// Returns the series for 'id', allocating its columns on first use. NULL on allocation failure
+MetricSeries* MetricStore_getOrCreate(MetricStore* this, int id) {
+    if (!this) return NULL;
+    MetricSeries* s = slotFor(this, id);
+    if (!s || s->columns) return s;
+
+    SeriesColumns* c = newColumns(SERIES_INITIAL_CAPACITY, NULL, 0);
+    if (!c) return NULL;
+
+    bindColumns(s, c);
+    s->sealed = 0;
+    s->count = 0;
+    s->sorted_count = 0;
+    s->capacity = SERIES_INITIAL_CAPACITY;
+    resetRanges(s);
+    return s;
+}
+
+// Points the series for 'id' at read-only columns owned by someone else (e.g. a sidecar
+// mapping). They are copied to the heap the first time the series grows. The owner must
+// outlive every view taken of the series before that
+bool MetricStore_adopt(MetricStore* this, int id, const int64_t* steps, const double* timestamps,
+                       const double* values, int64_t count) {
+    if (!this || count <= 0) return false;
+    MetricSeries* s = slotFor(this, id);
+    if (!s) return false;
+
+    SeriesColumns* c = calloc(1, sizeof(SeriesColumns));
+    if (!c) return false;
+    c->refcount = 1;
+    c->steps = (int64_t*)steps;
+    c->timestamps = (double*)timestamps;
+    c->values = (double*)values;
+    c->mapped = true;
+
+    freeSeries(s);
+    bindColumns(s, c);
+    s->count = count;
+    s->capacity = count;
+    s->sorted_count = count;
+    resetRanges(s);
+    for (int64_t i = 0; i < count; i++) trackRanges(s, timestamps[i], values[i]);
+    return true;
+}
+
+// Copies points [begin, begin + n) out of columns whose first 'sealed' points are in blocks
+// and whose later ones are in the given uncompressed arrays
+static void readColumns(const SeriesColumns* c, const int64_t* steps, const double* timestamps,
+                        const double* values, int64_t sealed, int64_t begin, int64_t n,
+                        int64_t* out_steps, double* out_timestamps, double* out_values) {
+    int64_t block_steps[SERIES_BLOCK_POINTS];
+    double block_timestamps[SERIES_BLOCK_POINTS];
+    double block_values[SERIES_BLOCK_POINTS];
+
+    int64_t done = 0;
+    while (done < n && begin + done < sealed) {
+        int64_t at = begin + done;
+        const SeriesBlock* block = c->blocks[at / SERIES_BLOCK_POINTS];
+        int offset = (int)(at % SERIES_BLOCK_POINTS);
+        int64_t take = block->count - offset;
+        if (take > n - done) take = n - done;
+
+        if (offset == 0 && take == block->count) {
+            // A whole block decodes straight into the output
+            SeriesBlock_decode(block, out_steps ? out_steps + done : NULL,
+                               out_timestamps ? out_timestamps + done : NULL,
+                               out_values ? out_values + done : NULL);
+        } else {
+            SeriesBlock_decode(block, out_steps ? block_steps : NULL,
+                               out_timestamps ? block_timestamps : NULL,
+                               out_values ? block_values : NULL);
+            if (out_steps) memcpy(out_steps + done, block_steps + offset, take * sizeof(int64_t));
+            if (out_timestamps) memcpy(out_timestamps + done, block_timestamps + offset, take * sizeof(double));
+            if (out_values) memcpy(out_values + done, block_values + offset, take * sizeof(double));
+        }
+        done += take;
+    }
+
+    if (done < n) {
+        int64_t at = begin + done - sealed;
+        int64_t rest = n - done;
+        if (out_steps) memcpy(out_steps + done, steps + at, rest * sizeof(int64_t));
+        if (out_timestamps) memcpy(out_timestamps + done, timestamps + at, rest * sizeof(double));
+        if (out_values) memcpy(out_values + done, values + at, rest * sizeof(double));
+    }
+}
+
+// Copies points [begin, begin + n) of a series into the given arrays, decompressing sealed
+// blocks as needed. Any output may be NULL
+void MetricStore_read(const MetricSeries* s, int64_t begin, int64_t n, int64_t* steps, double* timestamps, double* values) {
+    if (!s || !s->columns || begin < 0 || n <= 0 || begin + n > s->count) return;
+    readColumns(s->columns, s->steps, s->timestamps, s->values, s->sealed, begin, n, steps, timestamps, values);
+}
+
+// Returns the step of the first point of a non-empty series
+static int64_t firstStep(const MetricSeries* s) {
+    return s->sealed > 0 ? s->columns->blocks[0]->first_step : s->steps[0];
+}
+
+// Returns the step of the last point of a non-empty series
+static int64_t lastStep(const MetricSeries* s) {
+    if (s->count > s->sealed) return s->steps[s->count - 1 - s->sealed];
+    return s->columns->blocks[s->sealed / SERIES_BLOCK_POINTS - 1]->last_step;
+}
+
+// Grows a series' uncompressed arrays to hold at least 'capacity' points. Columns that a
+// view still references, or that belong to a mapping, are copied into fresh ones instead
+// of realloc'd; their sealed blocks are shared, not copied
+static bool reserve(MetricSeries* s, int64_t capacity) {
+    if (capacity <= s->capacity) return true;
+
+    SeriesColumns* c = s->columns;
+    if (c->refcount > 1 || c->mapped) {
+        // Trimmed points at the front are left behind with the old columns
+        SeriesColumns* grown = newColumns(capacity, c->blocks, c->block_count);
+        if (!grown) return false;
+
+        int64_t raw = s->count - s->sealed;
+        memcpy(grown->steps, s->steps, raw * sizeof(int64_t));
+        memcpy(grown->timestamps, s->timestamps, raw * sizeof(double));
+        memcpy(grown->values, s->values, raw * sizeof(double));
+        releaseColumns(c);
+        bindColumns(s, grown);
+        s->capacity = capacity;
+        return true;
+    }
+
+    // Slide the live points down over trimmed ones first; that may already be room enough
+    if (s->head > 0) {
+        int64_t raw = s->count - s->sealed;
+        memmove(c->steps, s->steps, raw * sizeof(int64_t));
+        memmove(c->timestamps, s->timestamps, raw * sizeof(double));
+        memmove(c->values, s->values, raw * sizeof(double));
+        s->capacity += s->head;
+        bindColumns(s, c);
+        if (capacity <= s->capacity) return true;
+    }
+
+    bool ok = resizeColumns(c, capacity);
+    bindColumns(s, c);
+    if (!ok) return false;
+
+    s->capacity = capacity;
+    return true;
+}
+
+// Adds a point at the end of a series. Returns false, leaving the series as it was, if
+// there was no memory to grow it
+bool MetricStore_append(MetricSeries* s, int64_t step, double timestamp, double value) {
+    if (!s || !s->columns) return false;
+
+    // Double capacity when full
+    int64_t raw = s->count - s->sealed;
+    if (raw >= s->capacity) {
+        int64_t new_capacity = s->capacity > 0 ? s->capacity * 2 : SERIES_INITIAL_CAPACITY;
+        if (!reserve(s, new_capacity)) return false;
+    }
+
+    // Rows almost always arrive in step order; a late one (e.g. a system sample taken just
+    // before the step counter moved) leaves the rest for MetricStore_sortPending
+    if (s->sorted_count == s->count && (s->count == 0 || step >= lastStep(s))) {
+        s->sorted_count++;
+    }
+    s->steps[raw] = step;
+    s->timestamps[raw] = timestamp;
+    s->values[raw] = value;
+    s->count++;
+    trackRanges(s, timestamp, value);
+    return true;
+}
+
+// Adds every point of 'src' to the end of 'dst'
+bool MetricStore_appendSeries(MetricSeries* dst, const MetricSeries* src) {
+    if (!src || src->count == 0) return true;
+    if (!dst || !dst->columns) return false;
+
+    int64_t raw = dst->count - dst->sealed;
+    int64_t needed = raw + src->count;
+    if (needed > dst->capacity) {
+        int64_t new_capacity = dst->capacity > 0 ? dst->capacity : SERIES_INITIAL_CAPACITY;
+        while (new_capacity < needed) new_capacity *= 2;
+        if (!reserve(dst, new_capacity)) return false;
+    }
+
+    // Still in order only if both halves are and they do not overlap
+    bool in_order = dst->sorted_count == dst->count && src->sorted_count == src->count &&
+                    (dst->count == 0 || firstStep(src) >= lastStep(dst));
+
+    MetricStore_read(src, 0, src->count, dst->steps + raw, dst->timestamps + raw, dst->values + raw);
+    dst->count += src->count;
+    if (in_order) dst->sorted_count = dst->count;
+    if (src->min_value < dst->min_value) dst->min_value = src->min_value;
+    if (src->max_value > dst->max_value) dst->max_value = src->max_value;
+    if (src->min_timestamp < dst->min_timestamp) dst->min_timestamp = src->min_timestamp;
+    if (src->max_timestamp > dst->max_timestamp) dst->max_timestamp = src->max_timestamp;
+    dst->merged += src->merged;
+    return true;
+}
+
+// Returns the index of the first of the leading 'limit' (sorted) points whose step is
+// greater than 'step', or at least 'step' unless 'upper'; 'limit' if there is none.
+// Sealed blocks are searched by their last step and only the block found is decoded
+static int64_t searchSteps(const MetricSeries* s, int64_t limit, int64_t step, bool upper) {
+    const SeriesColumns* c = s->columns;
+    int64_t blocks = s->sealed / SERIES_BLOCK_POINTS;
+
+    int64_t lo = 0, hi = blocks;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        int64_t last = c->blocks[mid]->last_step;
+        if (upper ? last <= step : last < step) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const int64_t* steps = s->steps;
+    int64_t base = s->sealed;
+    int64_t block_steps[SERIES_BLOCK_POINTS];
+    if (lo < blocks) {
+        SeriesBlock_decode(c->blocks[lo], block_steps, NULL, NULL);
+        steps = block_steps;
+        base = lo * SERIES_BLOCK_POINTS;
+        hi = c->blocks[lo]->count;
+    } else {
+        hi = limit - s->sealed;
+    }
+
+    lo = 0;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (upper ? steps[mid] <= step : steps[mid] < step) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return base + lo < limit ? base + lo : limit;
+}
+
+// A point's sort key: its step, then its position, which keeps equal steps in arrival order
+typedef struct {
+    int64_t step;
+    int64_t index;
+} SortKey;
+
+static int compareSortKeys(const void* a, const void* b) {
+    const SortKey* x = (const SortKey*)a;
+    const SortKey* y = (const SortKey*)b;
+    if (x->step != y->step) return x->step < y->step ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+// Sorts the unsorted tail of a series and merges it into the sorted prefix:
+// O(k log k + n) for k out-of-order points, rather than re-sorting everything. Only the
+// prefix from the earliest late step on is rewritten (reopening the sealed block that
+// step falls in, if any), into fresh columns so views of the old order stay intact
+static bool sortSeries(MetricSeries* s) {
+    int64_t n = s->count;
+    int64_t prefix = s->sorted_count;
+    int64_t k = n - prefix;
+
+    SortKey* tail = malloc((size_t)k * sizeof(SortKey));
+    if (!tail) return false;
+
+    for (int64_t i = 0; i < k; i++) {
+        tail[i].step = s->steps[prefix + i - s->sealed];
+        tail[i].index = prefix + i;
+    }
+    qsort(tail, (size_t)k, sizeof(SortKey), compareSortKeys);
+
+    int64_t from = searchSteps(s, prefix, tail[0].step, true);
+    int64_t keep_blocks = (from < s->sealed ? from : s->sealed) / SERIES_BLOCK_POINTS;
+    int64_t base = keep_blocks * SERIES_BLOCK_POINTS;
+    int64_t m = n - base;
+
+    SeriesColumns* sorted = newColumns(m, s->columns->blocks, keep_blocks);
+    if (!sorted) {
+        free(tail);
+        return false;
+    }
+    int64_t* steps = sorted->steps;
+    double* timestamps = sorted->timestamps;
+    double* values = sorted->values;
+
+    // Copy the rewritten part of the prefix to the front, then merge the tail in from the
+    // back. Stable: on equal steps the (earlier) prefix point stays first
+    MetricStore_read(s, base, prefix - base, steps, timestamps, values);
+    int64_t a = prefix - base - 1, b = k - 1;
+    for (int64_t out = m - 1; b >= 0; out--) {
+        if (a >= 0 && steps[a] > tail[b].step) {
+            steps[out] = steps[a];
+            timestamps[out] = timestamps[a];
+            values[out] = values[a];
+            a--;
+        } else {
+            int64_t raw = tail[b--].index - s->sealed;
+            steps[out] = s->steps[raw];
+            timestamps[out] = s->timestamps[raw];
+            values[out] = s->values[raw];
+        }
+    }
+    free(tail);
+
+    releaseColumns(s->columns);
+    bindColumns(s, sorted);
+    s->sealed = base;
+    s->capacity = m;
+    s->sorted_count = n;
+    return true;
+}
+
+// Restores step order in every series that received out-of-order points since the last
+// call. Lookups below assume this has run
+void MetricStore_sortPending(MetricStore* this) {
+    if (!this) return;
+    for (int i = 0; i < this->count; i++) {
+        MetricSeries* s = &this->series[i];
+        if (s->columns && s->sorted_count < s->count) sortSeries(s);
+    }
+}
+
+// Seals every full block of sorted points that is at least a block behind the newest point,
+// then trims the uncompressed arrays down to what is left
+static void sealSeries(MetricSeries* s) {
+    int64_t ready = (s->sorted_count - s->sealed) / SERIES_BLOCK_POINTS - 1;
+    if (ready <= 0 || s->columns->mapped) return;
+
+    SeriesBlock** fresh = malloc((size_t)ready * sizeof(SeriesBlock*));
+    if (!fresh) return;
+
+    int64_t encoded = 0;
+    while (encoded < ready) {
+        int64_t at = encoded * SERIES_BLOCK_POINTS;
+        fresh[encoded] = SeriesBlock_encode(s->steps + at, s->timestamps + at, s->values + at, SERIES_BLOCK_POINTS);
+        if (!fresh[encoded]) break;
+        encoded++;
+    }
+    if (encoded == 0) {
+        free(fresh);
+        return;
+    }
+
+    int64_t moved = encoded * SERIES_BLOCK_POINTS;
+    int64_t rest = s->count - s->sealed - moved;
+    int64_t capacity = rest > SERIES_INITIAL_CAPACITY / 2 ? rest * 2 : SERIES_INITIAL_CAPACITY;
+    if (capacity > s->capacity) capacity = s->capacity;
+
+    // Columns a view still references are left alone: the result goes into fresh ones
+    SeriesColumns* c = s->columns;
+    SeriesColumns* dst = c->refcount > 1 ? newColumns(capacity, c->blocks, c->block_count) : c;
+    if (!dst || !reserveBlocks(dst, dst->block_count + encoded)) {
+        if (dst && dst != c) releaseColumns(dst);
+        for (int64_t i = 0; i < encoded; i++) SeriesBlock_release(fresh[i]);
+        free(fresh);
+        return;
+    }
+
+    memcpy(dst->blocks + dst->block_count, fresh, (size_t)encoded * sizeof(SeriesBlock*));
+    dst->block_count += encoded;
+    free(fresh);
+
+    memmove(dst->steps, s->steps + moved, rest * sizeof(int64_t));
+    memmove(dst->timestamps, s->timestamps + moved, rest * sizeof(double));
+    memmove(dst->values, s->values + moved, rest * sizeof(double));
+    if (dst == c) {
+        // Shrinking keeps every point even if some realloc fails; those arrays just stay larger
+        resizeColumns(c, capacity);
+    } else {
+        releaseColumns(c);
+    }
+    bindColumns(s, dst);
+    s->sealed += moved;
+    s->capacity = capacity;
+}
+
+// Compresses every full block of sorted points that is at least a block behind the newest
+// point, so late rows rarely reopen a sealed block. Mapped columns are left as they are
+void MetricStore_compact(MetricStore* this) {
+    if (!this) return;
+    for (int i = 0; i < this->count; i++) {
+        MetricSeries* s = &this->series[i];
+        if (s->columns) sealSeries(s);
+    }
+}
+
+// Keeps only the points within 'window' steps of each series' last step, folding the rest
+// into the series' history. Dropped points are skipped over in place and their room is
+// reclaimed the next time the series needs to grow, so trimming costs O(dropped) and a
+// series that keeps trimming stays within a few windows of memory. Sealed or unsorted
+// series are left alone; a store being trimmed is not meant to be compacted
+void MetricStore_trim(MetricStore* this, int64_t window) {
+    if (!this || window <= 0) return;
+    for (int i = 0; i < this->count; i++) {
+        MetricSeries* s = &this->series[i];
+        if (!s->columns || s->count == 0 || s->sealed > 0 || s->sorted_count < s->count) continue;
+
+        int64_t last = lastStep(s);
+        int64_t first = last > INT64_MIN + window ? last - window + 1 : INT64_MIN;
+        int64_t dropped = searchSteps(s, s->count, first, false);
+        if (dropped == 0) continue;
+
+        MetricHistory* h = &s->history;
+        if (h->count == 0) {
+            h->min_value = INFINITY;
+            h->max_value = -INFINITY;
+        }
+        for (int64_t j = 0; j < dropped; j++) {
+            double value = s->values[j];
+            h->count++;
+            if (!isfinite(value)) continue;
+            h->finite++;
+            h->sum += value;
+            if (value < h->min_value) h->min_value = value;
+            if (value > h->max_value) h->max_value = value;
+        }
+
+        s->steps += dropped;
+        s->timestamps += dropped;
+        s->values += dropped;
+        s->head += dropped;
+        s->count -= dropped;
+        s->capacity -= dropped;
+        s->sorted_count -= dropped;
+
+        // The ranges only ever widened on append; narrow them to what is left
+        resetRanges(s);
+        for (int64_t j = 0; j < s->count; j++) trackRanges(s, s->timestamps[j], s->values[j]);
+    }
+}
+
+// Returns the bytes a series' points take up: its uncompressed arrays, trimmed room included,
+// and its sealed blocks. Mapped arrays count too, as their pages are resident all the same
+size_t MetricStore_bytes(const MetricSeries* s) {
+    if (!s || !s->columns) return 0;
+
+    const SeriesColumns* c = s->columns;
+    int64_t raw = c->mapped ? s->count : s->head + s->capacity;
+    size_t bytes = sizeof(SeriesColumns) + (size_t)raw * (sizeof(int64_t) + 2 * sizeof(double)) +
+                   (size_t)c->block_capacity * sizeof(SeriesBlock*);
+    for (int64_t i = 0; i < c->block_count; i++) {
+        bytes += sizeof(SeriesBlock) + c->blocks[i]->word_count * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+// Appends the points holding the lowest and highest finite value of one bucket to 'c' at
+// 'at', in their original order (just the first point if none is finite). Returns how many
+static int64_t keepExtremes(SeriesColumns* c, int64_t at, const int64_t* steps, const double* timestamps,
+                            const double* values, int n) {
+    int lo = -1, hi = -1;
+    for (int i = 0; i < n; i++) {
+        if (!isfinite(values[i])) continue;
+        if (lo < 0 || values[i] < values[lo]) lo = i;
+        if (hi < 0 || values[i] > values[hi]) hi = i;
+    }
+    if (lo < 0) lo = hi = 0;
+
+    int keep[2] = {lo < hi ? lo : hi, lo < hi ? hi : lo};
+    int64_t kept = 0;
+    for (int k = 0; k < (lo == hi ? 1 : 2); k++) {
+        c->steps[at + kept] = steps[keep[k]];
+        c->timestamps[at + kept] = timestamps[keep[k]];
+        c->values[at + kept] = values[keep[k]];
+        kept++;
+    }
+    return kept;
+}
+
+// Trades resolution in the older half of a sorted series for memory: each run of
+// DOWNSAMPLE_BUCKET_POINTS points there is replaced by its lowest and highest value, in step
+// order, so a chart keeps its envelope. Downsampling again folds those pairs further. The
+// ranges stay those of every point ever appended. Returns false if the series is too short,
+// unsorted or the new columns could not be allocated
+bool MetricStore_downsample(MetricStore* this, int id) {
+    if (!this || id < 0 || id >= this->count) return false;
+    MetricSeries* s = &this->series[id];
+    if (!s->columns || s->sorted_count < s->count) return false;
+
+    int64_t cut = s->count / 2 / DOWNSAMPLE_BUCKET_POINTS * DOWNSAMPLE_BUCKET_POINTS;
+    if (cut == 0) return false;
+    int64_t rest = s->count - cut;
+    int64_t capacity = cut / DOWNSAMPLE_BUCKET_POINTS * 2 + rest;
+
+    // The result goes into fresh columns, so views of the full points stay intact
+    SeriesColumns* c = newColumns(capacity, NULL, 0);
+    int64_t* steps = malloc(SERIES_BLOCK_POINTS * sizeof(int64_t));
+    double* timestamps = malloc(SERIES_BLOCK_POINTS * sizeof(double));
+    double* values = malloc(SERIES_BLOCK_POINTS * sizeof(double));
+    bool ok = c && steps && timestamps && values;
+
+    // Decode a block's worth at a time; the cut is a whole number of buckets
+    int64_t kept = 0;
+    for (int64_t i = 0; ok && i < cut; i += SERIES_BLOCK_POINTS) {
+        int n = (int)(cut - i < SERIES_BLOCK_POINTS ? cut - i : SERIES_BLOCK_POINTS);
+        MetricStore_read(s, i, n, steps, timestamps, values);
+        for (int b = 0; b < n; b += DOWNSAMPLE_BUCKET_POINTS) {
+            kept += keepExtremes(c, kept, steps + b, timestamps + b, values + b, DOWNSAMPLE_BUCKET_POINTS);
+        }
+    }
+    free(steps);
+    free(timestamps);
+    free(values);
+    if (!ok) {
+        releaseColumns(c);
+        return false;
+    }
+
+    MetricStore_read(s, cut, rest, c->steps + kept, c->timestamps + kept, c->values + kept);
+    s->merged += cut - kept;
+    releaseColumns(s->columns);
+    bindColumns(s, c);
+    s->sealed = 0;
+    s->count = kept + rest;
+    s->sorted_count = s->count;
+    s->capacity = capacity;
+
+    // Compress what settled right away, so the bytes freed are the bytes the series keeps
+    sealSeries(s);
+    return true;
+}
+
+// Returns a view of the series as it is now, without copying. Release it when done
+MetricView MetricStore_view(const MetricSeries* s) {
+    MetricView view;
+    memset(&view, 0, sizeof(view));
+    if (!s || !s->columns) return view;
+
+    s->columns->refcount++;
+    view.columns = s->columns;
+    view.steps = s->steps;
+    view.timestamps = s->timestamps;
+    view.values = s->values;
+    view.sealed = s->sealed;
+    view.count = s->count;
+    view.min_value = s->min_value;
+    view.max_value = s->max_value;
+    view.min_timestamp = s->min_timestamp;
+    view.max_timestamp = s->max_timestamp;
+    view.history = s->history;
+    view.merged = s->merged;
+    if (s->count > 0) {
+        view.first_step = firstStep(s);
+        view.last_step = lastStep(s);
+        MetricStore_read(s, s->count - 1, 1, NULL, NULL, &view.last_value);
+    }
+    return view;
+}
+
+// Copies points [begin, begin + n) of a view into the given arrays. Any output may be NULL
+void MetricView_read(const MetricView* view, int64_t begin, int64_t n, int64_t* steps, double* timestamps, double* values) {
+    if (!view || !view->columns || begin < 0 || n <= 0 || begin + n > view->count) return;
+    readColumns(view->columns, view->steps, view->timestamps, view->values, view->sealed,
+                begin, n, steps, timestamps, values);
+}
+
+// Returns a copy of a view that holds its own reference on the columns
+MetricView MetricView_retain(const MetricView* view) {
+    MetricView copy;
+    memset(&copy, 0, sizeof(copy));
+    if (!view) return copy;
+
+    // A view without columns has no points but may still carry ranges worth keeping
+    copy = *view;
+    if (copy.columns) copy.columns->refcount++;
+    return copy;
+}
+
+// Drops a view's reference on its columns
+void MetricView_release(MetricView* view) {
+    if (!view) return;
+    releaseColumns(view->columns);
+    memset(view, 0, sizeof(MetricView));
+}
@@ -0,0 +1,160 @@
+#ifndef EXPML_METRICSTORE_H
+#define EXPML_METRICSTORE_H
+
+#include "SeriesBlock.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Points MetricStore_downsample folds into one min/max pair (a divisor of SERIES_BLOCK_POINTS)
+#define DOWNSAMPLE_BUCKET_POINTS 64
+
+// Column storage shared by reference count between a series and the views taken of it:
+// settled points compressed into sealed blocks, then the newest points uncompressed.
+// Columns that are shared are never changed below a view's count; they get replaced,
+// not reallocated, when the series outgrows, re-sorts or seals them. The count is atomic
+// because views are released on the UI thread while the loader thread appends
+typedef struct SeriesColumns_ {
+    atomic_int refcount;
+    SeriesBlock** blocks;  // Sealed points, SERIES_BLOCK_POINTS per block
+    int64_t block_count;
+    int64_t block_capacity;
+    int64_t* steps;        // Uncompressed points after the sealed ones
+    double* timestamps;
+    double* values;
+    bool mapped;           // Arrays belong to a read-only mapping and are not freed here
+} SeriesColumns;
+
+// Running summary of the points MetricStore_trim has dropped from the front of a series
+typedef struct MetricHistory_ {
+    int64_t count;         // Points dropped
+    int64_t finite;        // How many of them had a finite value
+    double min_value;      // Range and sum of those finite values
+    double max_value;
+    double sum;
+} MetricHistory;
+
+// One key's points, sorted by step (points logged at the same step stay in arrival order).
+// Points appended out of order are sorted in by MetricStore_sortPending. Point i lives in
+// block i / SERIES_BLOCK_POINTS while i < sealed, and at steps[i - sealed] etc. after that.
+// Counts and indices are 64-bit: a long run can hold more than 2^31 points of one key
+typedef struct MetricSeries_ {
+    SeriesColumns* columns;
+    int64_t* steps;        // The columns' uncompressed arrays, cached (from 'head' on)
+    double* timestamps;
+    double* values;
+    int64_t head;          // Trimmed points still occupying the front of those arrays
+    int64_t sealed;        // Leading points held in the columns' blocks
+    int64_t count;
+    int64_t capacity;      // Room in the uncompressed arrays from 'head' on
+    int64_t sorted_count;  // Leading points known to be in step order
+    double min_value;      // Range of the finite values, kept up to date on append
+    double max_value;
+    double min_timestamp;  // Range of the finite timestamps
+    double max_timestamp;
+    MetricHistory history; // Points trimmed away, summarized
+    int64_t merged;        // Points MetricStore_downsample folded away; the series stands for count + merged
+} MetricSeries;
+
+// A read-only snapshot of the first 'count' points of a series. It holds a reference on
+// the columns, so later appends, growth, sorting and sealing never invalidate it
+typedef struct MetricView_ {
+    SeriesColumns* columns;
+    const int64_t* steps;
+    const double* timestamps;
+    const double* values;
+    int64_t sealed;
+    int64_t count;
+    int64_t first_step;
+    int64_t last_step;
+    double last_value;
+    double min_value;
+    double max_value;
+    double min_timestamp;
+    double max_timestamp;
+    MetricHistory history;
+    int64_t merged;
+} MetricView;
+
+// Struct-of-arrays store of every key's series, indexed by interned key id
+typedef struct MetricStore_ MetricStore;
+
+// Creates an empty store
+MetricStore* MetricStore_new(void);
+
+// Frees the store and every series it owns (mapped columns are left to their mapping)
+void MetricStore_delete(MetricStore* this);
+
+// Drops every series; slots for known ids stay allocated but empty
+void MetricStore_clear(MetricStore* this);
+
+// Drops the series for 'id', if any; views taken of it keep their columns
+void MetricStore_drop(MetricStore* this, int id);
+
+// Returns the number of id slots, i.e. one past the highest id ever used
+int MetricStore_count(const MetricStore* this);
+
+// Returns the series for 'id', or NULL if nothing was ever stored under it
+const MetricSeries* MetricStore_get(const MetricStore* this, int id);
+
+// Returns the series for 'id', allocating its columns on first use. NULL on allocation failure
+MetricSeries* MetricStore_getOrCreate(MetricStore* this, int id);
+
+// Points the series for 'id' at read-only columns owned by someone else (e.g. a sidecar
+// mapping). They are copied to the heap the first time the series grows. The owner must
+// outlive every view taken of the series before that
+bool MetricStore_adopt(MetricStore* this, int id, const int64_t* steps, const double* timestamps,
+                       const double* values, int64_t count);
+
+// Adds a point at the end of a series. Returns false, leaving the series as it was, if
+// there was no memory to grow it
+bool MetricStore_append(MetricSeries* s, int64_t step, double timestamp, double value);
+
+// Adds every point of 'src' to the end of 'dst'
+bool MetricStore_appendSeries(MetricSeries* dst, const MetricSeries* src);
+
+// Restores step order in every series that received out-of-order points since the last
+// call. Lookups below assume this has run
+void MetricStore_sortPending(MetricStore* this);
+
+// Compresses every full block of sorted points that is at least a block behind the newest
+// point, so late rows rarely reopen a sealed block. Mapped columns are left as they are
+void MetricStore_compact(MetricStore* this);
+
+// Keeps only the points within 'window' steps of each series' last step, folding the rest
+// into the series' history. Dropped points are skipped over in place and their room is
+// reclaimed the next time the series needs to grow, so trimming costs O(dropped) and a
+// series that keeps trimming stays within a few windows of memory. Sealed or unsorted
+// series are left alone; a store being trimmed is not meant to be compacted
+void MetricStore_trim(MetricStore* this, int64_t window);
+
+// Returns the bytes a series' points take up: its uncompressed arrays, trimmed room included,
+// and its sealed blocks. Mapped arrays count too, as their pages are resident all the same
+size_t MetricStore_bytes(const MetricSeries* s);
+
+// Trades resolution in the older half of a sorted series for memory: each run of
+// DOWNSAMPLE_BUCKET_POINTS points there is replaced by its lowest and highest value, in step
+// order, so a chart keeps its envelope. Downsampling again folds those pairs further. The
+// ranges stay those of every point ever appended. Returns false if the series is too short,
+// unsorted or the new columns could not be allocated
+bool MetricStore_downsample(MetricStore* this, int id);
+
+// Copies points [begin, begin + n) of a series into the given arrays, decompressing sealed
+// blocks as needed. Any output may be NULL
+void MetricStore_read(const MetricSeries* s, int64_t begin, int64_t n, int64_t* steps, double* timestamps, double* values);
+
+// Returns a view of the series as it is now, without copying. Release it when done
+MetricView MetricStore_view(const MetricSeries* s);
+
+// Copies points [begin, begin + n) of a view into the given arrays. Any output may be NULL
+void MetricView_read(const MetricView* view, int64_t begin, int64_t n, int64_t* steps, double* timestamps, double* values);
+
+// Returns a copy of a view that holds its own reference on the columns
+MetricView MetricView_retain(const MetricView* view);
+
+// Drops a view's reference on its columns
+void MetricView_release(MetricView* view);
+
+#endif
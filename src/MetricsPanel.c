@@ -4,6 +4,7 @@
 #include "Constants.h" 
 #include "SparkLine.h"
 #include "Terminal.h"
+#include "Arena.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,19 +12,49 @@
 #include <math.h> 
 #include <ncurses.h>
 
+#define METRIC_CARD_ARENA_BLOCK 16384   // A few hundred cards with their names
+#define METRIC_ROW_ARENA_BLOCK  4096
+#define VISIBLE_MARGIN_ROWS 1           // Rows off screen still reported as visible, so a scroll rarely waits
+
 // --- Internal Data Structures ---
 typedef struct {
+    int key_id;
     char* name;
-    float current_value;
-    float min_value;
-    float max_value;
-    float* history;
-    int history_count;
+    double current_value;
+    double min_value;
+    double max_value;
+    MetricView view;       // Shared, read-only columns of the loader's series, sorted by step
     int color_attr;
 } MetricData;
 
+// What the chart x axis is measured in
+typedef enum {
+    AXIS_STEP,             // The row's _step
+    AXIS_TIME,             // Wall time since the series' first point
+} MetricsAxis;
+
+// A card's chart as last drawn. Cards are rebuilt from every snapshot, so these are kept by
+// key id in the panel instead. Drawing an unchanged chart only blits its cells, and points
+// appended since the last draw are plotted onto the dots already there as long as the
+// chart's scales have not moved
+typedef struct {
+    Sparkline chart;       // Dots plotted so far; grid is NULL until first drawn
+    unsigned char* cells;  // Those dots as braille cells, chart.width x chart.height
+    MetricsAxis axis;      // What the chart was plotted against, and over which ranges
+    double x_min;
+    double x_max;
+    double y_min;
+    double y_max;
+    int64_t count;         // Points plotted
+    int64_t first_step;
+    int64_t merged;        // Points the view had lost to downsampling or trimming by then
+    int64_t trimmed;
+    double last_x;         // Last point plotted, to tell an append from a changed series
+    double last_value;
+} MetricChart;
+
 typedef struct {
-    MetricData** metrics; 
+    MetricData** metrics;  // Room for 'columns' cards
     int count;            
 } MetricRow;
 
@@ -34,17 +65,35 @@ typedef struct {
     int columns;          
     int selected_col;     
     int last_width;       
+    MetricsAxis axis;
+    Arena* cards;          // MetricData and names, dropped when the panel is repopulated
+    Arena* rows;           // MetricRow and their card arrays, dropped on every reflow
+    MetricsPanel_OnVisible on_visible;
+    void* visible_userdata;
+    int* visible;          // Key ids last reported on screen
+    int visible_count;
+    int visible_capacity;
+    MetricChart* charts;   // Indexed by key id, kept across repopulates
+    int chart_slots;
+    int* palette;          // Palette slot of each key id's card, -1 until it first appears
+    int palette_slots;
+    int palette_count;     // Slots handed out so far, one per key ever charted
 } MetricsState;
 
 // --- Helper Functions ---
 static void MetricsPanel_reflow(Panel* p);
 
-static void MetricsPanel_cleanupRow(void* data) {
-    MetricRow* row = (MetricRow*)data;
-    if (row) {
-        free(row->metrics); 
-        free(row);
-    }
+// Starts a new row of cards; NULL on allocation failure
+static MetricRow* MetricsPanel_addRow(Panel* p, MetricsState* state) {
+    MetricRow* row = Arena_alloc(state->rows, sizeof(MetricRow));
+    if (!row) return NULL;
+    row->count = 0;
+    row->metrics = Arena_alloc(state->rows, state->columns * sizeof(MetricData*));
+    if (!row->metrics) return NULL;
+
+    // Pass empty label as we draw everything custom
+    Panel_addItem(p, "", row);
+    return row;
 }
 
 static void MetricsPanel_handleResize(Panel* p, int w, int h) {
@@ -70,50 +119,189 @@ static void MetricsPanel_reflow(Panel* p) {
     state->columns = p->w / METRIC_MIN_WIDTH;
     if (state->columns < 1) state->columns = 1;
     
+    // Rows live in the arena, so the panel has nothing to free per item
     Panel_clear(p);
+    Arena_reset(state->rows);
     Panel_setItemHeight(p, METRIC_CARD_HEIGHT);
 
     for (int i = 0; i < state->total_count; i += state->columns) {
-        MetricRow* row = malloc(sizeof(MetricRow));
+        MetricRow* row = MetricsPanel_addRow(p, state);
+        if (!row) return;
         int remaining = state->total_count - i;
         row->count = (remaining < state->columns) ? remaining : state->columns;
         
-        row->metrics = malloc(row->count * sizeof(MetricData*));
         for (int k = 0; k < row->count; k++) {
             row->metrics[k] = state->all_metrics[i + k];
         }
-        
-        // Pass empty label as we draw everything custom
-        Panel_addItem(p, "", row); 
     }
 }
 
 // --- Smart Axis Logic ---
 
 // Returns a "Nice" step size (1, 2, 5, 10, 20, 50...)
-static int calculate_nice_step(int range, int target_ticks) {
+static double calculate_nice_step(double range, int target_ticks) {
     if (target_ticks <= 0) target_ticks = 1;
     if (range <= 0) return 1;
 
-    double raw_step = (double)range / target_ticks;
+    double raw_step = range / target_ticks;
     
     // Calculate magnitude (power of 10)
     double mag = pow(10, floor(log10(raw_step > 0 ? raw_step : 1)));
     double residual = raw_step / mag;
     
-    int nice_step;
-    if (residual > 5.0)      nice_step = 10 * (int)mag;
-    else if (residual > 2.0) nice_step = 5 * (int)mag;
-    else if (residual > 1.0) nice_step = 2 * (int)mag;
-    else                     nice_step = 1 * (int)mag;
+    double nice_step;
+    if (residual > 5.0)      nice_step = 10 * mag;
+    else if (residual > 2.0) nice_step = 5 * mag;
+    else if (residual > 1.0) nice_step = 2 * mag;
+    else                     nice_step = 1 * mag;
     
     if (nice_step < 1) nice_step = 1;
     return nice_step;
 }
 
+// Formats an x axis tick: a step count ("500", "12k", "1.5M") or elapsed seconds ("45s", "20m", "3h")
+static void format_tick(char* buf, size_t size, double val, MetricsAxis axis) {
+    if (axis == AXIS_TIME) {
+        if (val < 60)        snprintf(buf, size, "%.0fs", val);
+        else if (val < 3600) snprintf(buf, size, "%.0fm", val / 60);
+        else                 snprintf(buf, size, "%.3gh", val / 3600);
+    } else {
+        if (fabs(val) < 10000)        snprintf(buf, size, "%.0f", val);
+        else if (fabs(val) < 1000000) snprintf(buf, size, "%.3gk", val / 1000);
+        else                          snprintf(buf, size, "%.3gM", val / 1000000);
+    }
+}
+
 // --- Drawing Logic ---
 
-static void draw_card(MetricData* m, int y, int x, int w, int h, bool selected) {
+// Returns the cached chart of key 'key_id', growing the cache on demand; NULL if there is none
+static MetricChart* MetricsPanel_chartFor(MetricsState* state, int key_id) {
+    if (key_id < 0) return NULL;
+    if (key_id >= state->chart_slots) {
+        int new_slots = state->chart_slots ? state->chart_slots : 64;
+        while (new_slots <= key_id) new_slots *= 2;
+        MetricChart* grown = realloc(state->charts, new_slots * sizeof(MetricChart));
+        if (!grown) return NULL;
+        memset(&grown[state->chart_slots], 0, (new_slots - state->chart_slots) * sizeof(MetricChart));
+        state->charts = grown;
+        state->chart_slots = new_slots;
+    }
+    return &state->charts[key_id];
+}
+
+// Returns the palette slot of a key's card. Slots go to charted keys in the order their
+// cards first appear and stay theirs across repopulates, so colors neither skip the keys
+// that are never charted (_step, system metrics) nor shift when new ones show up
+static int MetricsPanel_paletteSlot(MetricsState* state, int key_id) {
+    if (key_id < 0) return state->total_count;
+    if (key_id >= state->palette_slots) {
+        int new_slots = state->palette_slots ? state->palette_slots : 64;
+        while (new_slots <= key_id) new_slots *= 2;
+        int* grown = realloc(state->palette, new_slots * sizeof(int));
+        if (!grown) return key_id;
+        for (int i = state->palette_slots; i < new_slots; i++) grown[i] = -1;
+        state->palette = grown;
+        state->palette_slots = new_slots;
+    }
+    if (state->palette[key_id] < 0) state->palette[key_id] = state->palette_count++;
+    return state->palette[key_id];
+}
+
+// Compares two doubles, counting NaN as equal to itself
+static bool same_double(double a, double b) {
+    return a == b || (isnan(a) && isnan(b));
+}
+
+// Plots points [from, v->count) of a view onto a chart, one (decompressed) block at a time,
+// and returns where the last of them was placed on the axis and its value
+static void plot_points(Sparkline* chart, const MetricView* v, MetricsAxis axis, int64_t from,
+                        double* last_x, double* last_value) {
+    int64_t steps[SERIES_BLOCK_POINTS];
+    double timestamps[SERIES_BLOCK_POINTS];
+    double values[SERIES_BLOCK_POINTS];
+    for (int64_t i = from; i < v->count; i += SERIES_BLOCK_POINTS) {
+        int64_t n = v->count - i < SERIES_BLOCK_POINTS ? v->count - i : SERIES_BLOCK_POINTS;
+        if (axis == AXIS_STEP) {
+            MetricView_read(v, i, n, steps, NULL, values);
+            Sparkline_plot(chart, values, steps, NULL, (size_t)n);
+            *last_x = (double)steps[n - 1];
+        } else {
+            MetricView_read(v, i, n, NULL, timestamps, values);
+            Sparkline_plot(chart, values, NULL, timestamps, (size_t)n);
+            *last_x = timestamps[n - 1];
+        }
+        *last_value = values[n - 1];
+    }
+}
+
+// Returns where point 'index' of a view is placed on the axis, and its value
+static void read_point(const MetricView* v, MetricsAxis axis, int64_t index, double* px, double* value) {
+    int64_t step;
+    if (axis == AXIS_STEP) {
+        MetricView_read(v, index, 1, &step, NULL, value);
+        *px = (double)step;
+    } else {
+        MetricView_read(v, index, 1, NULL, px, value);
+    }
+}
+
+// Draws a card's braille chart from its cache when possible. The cache holds if the size,
+// axis, scales and the points plotted are unchanged: the view may only have grown at the
+// end. Then only the new points are plotted and, if there are none, the cells are blitted
+// as they are. Anything else plots the chart again from scratch
+static void draw_chart(MetricChart* c, const MetricData* m, MetricsAxis axis, double x_min, double x_max,
+                       int y, int x, int w, int h, int color) {
+    const MetricView* v = &m->view;
+    if (!c) {
+        Sparkline chart;
+        double last_x, last_value;
+        if (!Sparkline_begin(&chart, w, h, x_min, x_max, m->min_value, m->max_value)) return;
+        plot_points(&chart, v, axis, 0, &last_x, &last_value);
+        Sparkline_finish(&chart, y, x, color);
+        return;
+    }
+
+    bool cached = c->chart.grid && c->chart.width == w && c->chart.height == h && c->axis == axis &&
+                  same_double(c->x_min, x_min) && same_double(c->x_max, x_max) &&
+                  c->y_min == m->min_value && c->y_max == m->max_value && v->count >= c->count &&
+                  v->merged == c->merged && v->history.count == c->trimmed;
+    if (cached && c->count > 0) {
+        // The points plotted must still lead the view; a late row sorted in before them, a
+        // trim or a reload would have moved the last of them
+        double px, value;
+        read_point(v, axis, c->count - 1, &px, &value);
+        cached = v->first_step == c->first_step && same_double(px, c->last_x) && same_double(value, c->last_value);
+    }
+
+    if (!cached) {
+        Sparkline_free(&c->chart);
+        free(c->cells);
+        c->cells = malloc((size_t)w * h);
+        if (!c->cells || !Sparkline_begin(&c->chart, w, h, x_min, x_max, m->min_value, m->max_value)) {
+            free(c->cells);
+            c->cells = NULL;
+            return;
+        }
+        c->axis = axis;
+        c->x_min = x_min;
+        c->x_max = x_max;
+        c->y_min = m->min_value;
+        c->y_max = m->max_value;
+        c->count = 0;
+        c->first_step = v->first_step;
+        c->merged = v->merged;
+        c->trimmed = v->history.count;
+    }
+
+    if (!cached || v->count > c->count) {
+        plot_points(&c->chart, v, axis, c->count, &c->last_x, &c->last_value);
+        c->count = v->count;
+        Sparkline_rasterize(&c->chart, c->cells);
+    }
+    Sparkline_blit(c->cells, w, h, y, x, color);
+}
+
+static void draw_card(MetricData* m, MetricChart* chart, MetricsAxis axis, int y, int x, int w, int h, bool selected) {
     if (!m) return;
 
     // --- Colors ---
@@ -155,6 +343,19 @@ static void draw_card(MetricData* m, int y, int x, int w, int h, bool selected)
     mvprintw(y + 1, x + w - 2 - strlen(val_buf), "%s", val_buf);
     attroff(value_color | A_BOLD);
 
+    // Points a --window run has dropped are only kept as a summary; show it under the header
+    attron(dim_color);
+    mvhline(y + 2, x + 1, ' ', w - 2);
+    const MetricHistory* history = &m->view.history;
+    if (history->finite > 0 && w > 6) {
+        char hist_buf[96];
+        snprintf(hist_buf, sizeof(hist_buf), "earlier  min %.4g  max %.4g  mean %.4g  (%lld pts)",
+                 history->min_value, history->max_value, history->sum / (double)history->finite,
+                 (long long)history->count);
+        mvprintw(y + 2, x + 2, "%.*s", w - 4, hist_buf);
+    }
+    attroff(dim_color);
+
    // 3. Y-AXIS LABELS
     attron(dim_color);
     mvprintw(y + 3, x + 2, "%4.1f", m->max_value);
@@ -198,13 +399,38 @@ static void draw_card(MetricData* m, int y, int x, int w, int h, bool selected)
         int max_labels = graph_w / 8; // Density control
         if (max_labels < 2) max_labels = 2;
         
-        int nice_step = calculate_nice_step(m->history_count, max_labels);
+        // X range: the series' step span, or its wall-clock span (labelled relative to the
+        // first point, so ticks read as elapsed time). A card laid out from the key manifest
+        // has a step span before it has any points, but no timestamps
+        double x_min = 0, x_max = 0, x_origin = 0;
+        const MetricView* v = &m->view;
+        bool has_range = false;
+        if (axis == AXIS_TIME) {
+            if (v->count > 0 && v->min_timestamp <= v->max_timestamp) {
+                x_min = v->min_timestamp;
+                x_max = v->max_timestamp;
+            }
+            x_origin = x_min;
+            has_range = v->count > 0;
+        } else if (v->count > 0 || v->first_step <= v->last_step) {
+            x_min = (double)v->first_step;
+            x_max = (double)v->last_step;
+            has_range = true;
+        }
+        double x_range = x_max - x_min;
+
+        // Time ticks are picked in whole minutes or hours once the span is long enough
+        double unit = 1;
+        if (axis == AXIS_TIME) unit = x_range >= 7200 ? 3600 : (x_range >= 120 ? 60 : 1);
+        double nice_step = calculate_nice_step(x_range / unit, max_labels) * unit;
         int last_label_end_x = -1;
 
-        for (int val = 0; val <= m->history_count; val += nice_step) {
-            if (m->history_count == 0) break;
+        // First tick at the first multiple of the step inside the range
+        double first_tick = ceil((x_min - x_origin) / nice_step) * nice_step;
+        for (double val = first_tick; val <= x_max - x_origin; val += nice_step) {
+            if (!has_range) break;
 
-            double ratio = (double)val / m->history_count;
+            double ratio = x_range > 0 ? (val + x_origin - x_min) / x_range : 0;
             int px = (int)(ratio * (graph_w - 1));
             int screen_x = graph_x + px;
 
@@ -213,7 +439,7 @@ static void draw_card(MetricData* m, int y, int x, int w, int h, bool selected)
 
             // Draw Label
             char buf[16];
-            snprintf(buf, 16, "%d", val);
+            format_tick(buf, sizeof(buf), val, axis);
             int len = strlen(buf);
             int start_x = screen_x - (len / 2);
 
@@ -230,16 +456,48 @@ static void draw_card(MetricData* m, int y, int x, int w, int h, bool selected)
         attroff(dim_color);
         
         // Draw Braille Line Chart
-        // Ensure Sparkline_draw only draws foreground characters
-        Sparkline_draw(m->history, m->history_count, 
-                       graph_y, graph_x, graph_w, graph_h, 
-                       chart_color);
+        draw_chart(chart, m, axis, x_min, x_max, graph_y, graph_x, graph_w, graph_h, chart_color);
     }
 }
 
+// Reports the key ids of the cards on screen if they are not the ones reported last
+static void MetricsPanel_reportVisible(Panel* panel, MetricsState* state) {
+    int rows = Panel_getItemCount(panel);
+    int first = panel->scroll_v - VISIBLE_MARGIN_ROWS;
+    int last = panel->scroll_v + Panel_getVisibleCount(panel) + VISIBLE_MARGIN_ROWS;
+    if (first < 0) first = 0;
+    if (last > rows) last = rows;
+
+    int needed = (last - first) * state->columns;
+    if (needed > state->visible_capacity) {
+        int* grown = realloc(state->visible, needed * sizeof(int));
+        if (!grown) return;
+        state->visible = grown;
+        state->visible_capacity = needed;
+    }
+
+    // Cards are laid out in key order, so comparing in order is enough
+    int count = 0;
+    bool changed = false;
+    for (int r = first; r < last; r++) {
+        MetricRow* row = (MetricRow*)Panel_getItem(panel, r)->data;
+        for (int k = 0; row && k < row->count; k++) {
+            int id = row->metrics[k]->key_id;
+            if (count >= state->visible_count || state->visible[count] != id) changed = true;
+            state->visible[count++] = id;
+        }
+    }
+    if (!changed && count == state->visible_count) return;
+    state->visible_count = count;
+    state->on_visible(state->visible, count, state->visible_userdata);
+}
+
 static void MetricsPanel_drawItem(Panel* panel, int index, int y, int x, int w, bool row_selected) {
     MetricsState* state = (MetricsState*)Panel_getUserData(panel);
 
+    // The first row drawn knows the scroll position the others are drawn at
+    if (index == panel->scroll_v && state->on_visible) MetricsPanel_reportVisible(panel, state);
+
     mvhline(y, x, ' ', w); 
 
     PanelItem* item = Panel_getItem(panel, index);
@@ -266,7 +524,8 @@ static void MetricsPanel_drawItem(Panel* panel, int index, int y, int x, int w,
              is_card_focused = (i == row->count - 1);
         }
 
-        draw_card(row->metrics[i], y, card_x, current_card_w, METRIC_CARD_HEIGHT, is_card_focused);
+        MetricChart* chart = MetricsPanel_chartFor(state, row->metrics[i]->key_id);
+        draw_card(row->metrics[i], chart, state->axis, y, card_x, current_card_w, METRIC_CARD_HEIGHT, is_card_focused);
     }
 }
 
@@ -276,6 +535,13 @@ static HandlerResult MetricsPanel_handleKey(Panel* p, int key) {
     int current_row_idx = Panel_getSelectedIndex(p);
     int total_rows = Panel_getItemCount(p);
     
+    // Toggle the x axis of every chart between _step and wall time
+    if (key == 'x') {
+        state->axis = (state->axis == AXIS_STEP) ? AXIS_TIME : AXIS_STEP;
+        Panel_setNeedsRedraw(p);
+        return HANDLED;
+    }
+
     PanelItem* item = Panel_getSelected(p);
     if (!item || !item->data) return IGNORED;
     MetricRow* current_row = (MetricRow*)item->data;
@@ -334,6 +600,8 @@ Panel* MetricsPanel_new(int x, int y, int w, int h) {
     if (!p) return NULL;
 
     MetricsState* state = calloc(1, sizeof(MetricsState));
+    state->cards = Arena_new(METRIC_CARD_ARENA_BLOCK);
+    state->rows = Arena_new(METRIC_ROW_ARENA_BLOCK);
     state->columns = 1;
     state->all_metrics = malloc(16 * sizeof(MetricData*));
     state->capacity = 16;
@@ -342,7 +610,6 @@ Panel* MetricsPanel_new(int x, int y, int w, int h) {
     
     Panel_setUserData(p, state);
     Panel_setDrawItem(p, MetricsPanel_drawItem);
-    Panel_setCleanupCallback(p, MetricsPanel_cleanupRow); 
     Panel_setEventHandler(p, MetricsPanel_handleKey);
     Panel_setItemHeight(p, METRIC_CARD_HEIGHT);
     Panel_setResizeCallback(p, MetricsPanel_handleResize);
@@ -350,8 +617,8 @@ Panel* MetricsPanel_new(int x, int y, int w, int h) {
     return p;
 }
 
-void MetricsPanel_addMetric(Panel* panel, const char* name, float current_val, const float* values, int count) {
-    if (!panel) return;
+void MetricsPanel_addMetric(Panel* panel, int key_id, const char* name, const MetricView* view) {
+    if (!panel || !view) return;
     MetricsState* state = (MetricsState*)Panel_getUserData(panel);
 
     // Auto-reset logic: If the panel is empty (cleared) but state has items,
@@ -359,26 +626,30 @@ void MetricsPanel_addMetric(Panel* panel, const char* name, float current_val, c
     if (Panel_getItemCount(panel) == 0 && state->total_count > 0) {
         for(int i=0; i<state->total_count; i++) {
             if (state->all_metrics[i]) {
-                free(state->all_metrics[i]->name);
-                free(state->all_metrics[i]->history);
-                free(state->all_metrics[i]);
+                MetricView_release(&state->all_metrics[i]->view);
             }
         }
         state->total_count = 0;
+        Arena_reset(state->cards);
+        Arena_reset(state->rows);
     }
 
-    MetricData* m = calloc(1, sizeof(MetricData));
-    m->name = strdup(name);
-    m->current_value = current_val;
-    m->history_count = count;
-    m->history = malloc(count * sizeof(float));
-    memcpy(m->history, values, count * sizeof(float));
-    
-    m->min_value = values[0];
-    m->max_value = values[0];
-    for(int i=0; i<count; i++) {
-        if(values[i] < m->min_value) m->min_value = values[i];
-        if(values[i] > m->max_value) m->max_value = values[i];
+    MetricData* m = Arena_alloc(state->cards, sizeof(MetricData));
+    if (!m) return;
+    memset(m, 0, sizeof(MetricData));
+    m->key_id = key_id;
+    m->name = Arena_strdup(state->cards, name);
+
+    // Share the snapshot's columns instead of copying them; the store keeps the value range
+    m->view = MetricView_retain(view);
+    m->current_value = m->view.last_value;
+    m->min_value = m->view.min_value;
+    m->max_value = m->view.max_value;
+
+    // No finite value yet (all NaN): give the chart an arbitrary range
+    if (m->min_value > m->max_value) {
+        m->min_value = 0;
+        m->max_value = 1;
     }
     
     // Prevent flat lines looking weird (avoid min == max)
@@ -386,8 +657,8 @@ void MetricsPanel_addMetric(Panel* panel, const char* name, float current_val, c
         m->max_value += 0.0001; 
     }
 
-    // 1. Get the absolute index (current total count)
-    int abs_index = state->total_count;
+    // 1. Use the key's own palette slot so a card keeps its color when other keys appear
+    int abs_index = MetricsPanel_paletteSlot(state, key_id);
 
     // 2. Modulo by palette size (defined in Terminal.h as 10)
     int palette_idx = abs_index % CHART_PALETTE_SIZE;
@@ -402,7 +673,23 @@ void MetricsPanel_addMetric(Panel* panel, const char* name, float current_val, c
     }
     state->all_metrics[state->total_count++] = m;
 
-    MetricsPanel_reflow(panel);
+    // Fill up the last row instead of reflowing: a populate adds every card one by one,
+    // and relaying out all of them each time made it quadratic in the number of cards
+    if (panel->w != state->last_width) {
+        MetricsPanel_reflow(panel);
+        return;
+    }
+    int rows = Panel_getItemCount(panel);
+    MetricRow* row = rows > 0 ? (MetricRow*)Panel_getItem(panel, rows - 1)->data : NULL;
+    if (!row || row->count >= state->columns) row = MetricsPanel_addRow(panel, state);
+    if (row) row->metrics[row->count++] = m;
+}
+
+void MetricsPanel_setVisibleCallback(Panel* panel, MetricsPanel_OnVisible callback, void* userdata) {
+    MetricsState* state = (MetricsState*)Panel_getUserData(panel);
+    if (!state) return;
+    state->on_visible = callback;
+    state->visible_userdata = userdata;
 }
 
 void MetricsPanel_updateSize(Panel* p, int w, int h) {
@@ -2,13 +2,24 @@
 #define EXPML_METRICSPANEL_H
 
 #include "Panel.h"
+#include "MetricStore.h"
 
 // Creates a new Metrics Grid Panel
 Panel* MetricsPanel_new(int x, int y, int w, int h);
 
-// Adds a metric card to the grid
+// Adds a metric card to the grid. 'key_id' is the loader's stable interned key id; it keeps
+// the card's chart color fixed as keys are added or filtered. The card plots the series
+// against its real _step (or wall time, toggled with 'x') and shows its last value.
+// The card keeps its own reference on the view's columns; the caller releases its copy.
 // If the panel was recently cleared, this resets the internal state automatically.
-void MetricsPanel_addMetric(Panel* panel, const char* name, float current_val, const float* values, int count);
+void MetricsPanel_addMetric(Panel* panel, int key_id, const char* name, const MetricView* view);
+
+// Called with the key ids of the cards on screen (plus a row either side) whenever that
+// set changes, so their owner can load the history of those keys only
+typedef void (*MetricsPanel_OnVisible)(const int* key_ids, int count, void* userdata);
+
+// Sets the callback told which cards are on screen
+void MetricsPanel_setVisibleCallback(Panel* panel, MetricsPanel_OnVisible callback, void* userdata);
 
 // Updates layout when terminal resizes
 void MetricsPanel_updateSize(Panel* panel, int w, int h);
@@ -0,0 +1,247 @@
+#include "MetricsParser.h"
+#include "JsonScan.h"
+#include "FastFloat.h"
+#include "Arena.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+
+#define RECORD_INITIAL_CAPACITY 64
+#define RECORD_ARENA_BLOCK 4096   // Room for the tree of a typical nested row
+
+// Prepares an empty record
+void MetricRecord_init(MetricRecord* record) {
+    if (!record) return;
+    memset(record, 0, sizeof(MetricRecord));
+    record->step = -1;
+}
+
+// Releases the field buffer and the arena of any fallback tree held by the record
+void MetricRecord_done(MetricRecord* record) {
+    if (!record) return;
+    free(record->fields);
+    free(record->index);
+    Arena_delete(record->arena);
+    MetricRecord_init(record);
+}
+
+// Empties the record for the next line while keeping its field buffer
+void MetricRecord_clear(MetricRecord* record) {
+    record->count = 0;
+    record->step = -1;
+    record->timestamp = 0.0;
+    if (record->fallback) {
+        Arena_reset(record->arena);
+        record->fallback = NULL;
+    }
+}
+
+// Converts a parsed "_step" number to a step, or -1 if it is not finite or out of int64 range
+int64_t MetricsParser_toStep(double value) {
+    // 2^63 is exact as a double; anything at or beyond it would not convert
+    if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) return -1;
+    return (int64_t)value;
+}
+
+// Appends a field, growing the reusable buffer geometrically when full.
+// "_step" and "_timestamp" are also copied into the record's bookkeeping fields
+bool MetricRecord_addField(MetricRecord* record, const char* key, size_t key_len, double value) {
+    if (record->count >= record->capacity) {
+        size_t new_capacity = record->capacity ? record->capacity * 2 : RECORD_INITIAL_CAPACITY;
+        MetricField* new_fields = realloc(record->fields, new_capacity * sizeof(MetricField));
+        if (!new_fields) return false;
+        record->fields = new_fields;
+        record->capacity = new_capacity;
+    }
+
+    // Pick up the reserved bookkeeping fields as they stream past
+    if (key_len == 5 && memcmp(key, "_step", 5) == 0) {
+        record->step = MetricsParser_toStep(value);
+    } else if (key_len == 10 && memcmp(key, "_timestamp", 10) == 0) {
+        record->timestamp = value;
+    }
+
+    MetricField* f = &record->fields[record->count++];
+    f->key = key;
+    f->key_len = key_len;
+    f->value = value;
+    f->text = NULL;
+    f->text_len = 0;
+    return true;
+}
+
+static inline const char* skipWhitespace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+static inline bool matchLiteral(const char* p, const char* end, const char* lit, size_t len) {
+    return (size_t)(end - p) >= len && memcmp(p, lit, len) == 0;
+}
+
+// Parses a JSON number, plus the NaN/Infinity tokens Python's json module emits for
+// non-finite floats. Returns the end of the number, or NULL if it is not one
+static const char* parseNumber(const char* p, const char* end, double* out) {
+    const char* digits = (p < end && *p == '-') ? p + 1 : p;
+
+    if (matchLiteral(digits, end, "Infinity", 8)) {
+        *out = (digits != p) ? -INFINITY : INFINITY;
+        return digits + 8;
+    }
+    if (digits == p && matchLiteral(p, end, "NaN", 3)) {
+        *out = NAN;
+        return p + 3;
+    }
+    return FastFloat_parse(p, end, out);
+}
+
+// Returns the value of a field, parsing it now if it was deferred. Returns false if the
+// deferred text is not a number
+bool MetricsParser_fieldValue(const MetricField* field, double* value) {
+    if (!field->text) {
+        *value = field->value;
+        return true;
+    }
+    return parseNumber(field->text, field->text + field->text_len, value) == field->text + field->text_len;
+}
+
+// Returns true if [p, end) is exactly true, false or null
+static inline bool isKeywordLiteral(const char* p, const char* end) {
+    size_t len = (size_t)(end - p);
+    if (len == 4) return memcmp(p, "true", 4) == 0 || memcmp(p, "null", 4) == 0;
+    return len == 5 && memcmp(p, "false", 5) == 0;
+}
+
+// Makes sure the scratch index can hold one entry per byte of a 'len'-byte line
+static bool reserveIndex(MetricRecord* record, size_t len) {
+    if (len <= record->index_capacity) return true;
+
+    size_t new_capacity = record->index_capacity ? record->index_capacity : 1024;
+    while (new_capacity < len) new_capacity *= 2;
+
+    uint32_t* new_index = realloc(record->index, new_capacity * sizeof(uint32_t));
+    if (!new_index) return false;
+    record->index = new_index;
+    record->index_capacity = new_capacity;
+    return true;
+}
+
+// Returns true if [p, end) holds nothing but whitespace
+static inline bool onlyWhitespace(const char* p, const char* end) {
+    return skipWhitespace(p, end) == end;
+}
+
+// Tokenizes a flat {"key": scalar, ...} object in place, recording its numeric fields.
+// A structural index is built first, so the walk below jumps from quote to colon to comma
+// without looking at the bytes in between. Returns false on anything it does not handle
+// (escapes, nested containers) so the caller can fall back to cJSON
+static bool parseFlatObject(const char* line, size_t len, MetricRecord* record) {
+    if (len > UINT32_MAX || !reserveIndex(record, len)) return false;
+
+    bool has_escape;
+    const uint32_t* idx = record->index;
+    size_t n = JsonScan_index(line, len, record->index, &has_escape);
+    if (has_escape || n < 2) return false;
+
+    // Opening brace, preceded only by whitespace
+    if (line[idx[0]] != '{' || !onlyWhitespace(line, line + idx[0])) return false;
+
+    size_t i = 1;
+    if (line[idx[i]] != '}') {
+        for (;;) {
+            // Key: quote, quote, colon
+            if (i + 3 >= n || line[idx[i]] != '"' || line[idx[i + 1]] != '"' || line[idx[i + 2]] != ':') {
+                return false;
+            }
+            const char* key = line + idx[i] + 1;
+            size_t key_len = idx[i + 1] - idx[i] - 1;
+            if (!onlyWhitespace(line + idx[i + 1] + 1, line + idx[i + 2])) return false;
+
+            const char* value = skipWhitespace(line + idx[i + 2] + 1, line + len);
+            i += 3;
+
+            char c = line[idx[i]];
+            if (c == '"') {
+                // String value: skip over it to the separator after its closing quote
+                if (i + 2 >= n || line + idx[i] != value || line[idx[i + 1]] != '"') return false;
+                if (!onlyWhitespace(line + idx[i + 1] + 1, line + idx[i + 2])) return false;
+                i += 2;
+            } else if (c == ',' || c == '}') {
+                // Scalar value spans up to the separator
+                const char* value_end = line + idx[i];
+                while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t' ||
+                                             value_end[-1] == '\r' || value_end[-1] == '\n')) {
+                    value_end--;
+                }
+
+                // Booleans and nulls are valid but not plotted
+                if (!isKeywordLiteral(value, value_end)) {
+                    if (record->defer_values && key_len > 0 && key[0] != '_') {
+                        // Keep the number's text; most of them may never be looked at
+                        if (value == value_end || !MetricRecord_addField(record, key, key_len, NAN)) return false;
+                        MetricField* f = &record->fields[record->count - 1];
+                        f->text = value;
+                        f->text_len = (size_t)(value_end - value);
+                    } else {
+                        double number;
+                        if (parseNumber(value, value_end, &number) != value_end) return false;
+                        if (!MetricRecord_addField(record, key, key_len, number)) return false;
+                    }
+                }
+            } else {
+                // Nested object or array
+                return false;
+            }
+
+            // Separator
+            if (line[idx[i]] == ',') {
+                i++;
+                continue;
+            }
+            if (line[idx[i]] == '}') break;
+            return false;
+        }
+    }
+
+    // The closing brace must be the last structural character, followed only by whitespace
+    return i == n - 1 && onlyWhitespace(line + idx[i] + 1, line + len);
+}
+
+// Slow path for rows the tokenizer rejected: build a cJSON tree and keep it alive
+// for as long as the record's keys point into it. The tree comes from the record's own
+// arena, so a run of nested rows reuses one block instead of allocating every node
+static bool parseWithCJSON(const char* line, size_t len, MetricRecord* record) {
+    if (!record->arena) record->arena = Arena_new(RECORD_ARENA_BLOCK);
+    if (!record->arena) return false;
+
+    Arena* previous = Arena_useForJson(record->arena);
+    cJSON* json = cJSON_ParseWithLength(line, len);
+    Arena_useForJson(previous);
+    if (!json || !cJSON_IsObject(json)) {
+        Arena_reset(record->arena);
+        return false;
+    }
+
+    record->fallback = json;
+    cJSON* item;
+    cJSON_ArrayForEach(item, json) {
+        if (!item->string || !cJSON_IsNumber(item)) continue;
+        if (!MetricRecord_addField(record, item->string, strlen(item->string), item->valuedouble)) break;
+    }
+    return true;
+}
+
+// Parses one JSONL row into the record. Flat {"key": number, ...} rows are tokenized in
+// place; anything else (nested values, escaped keys) goes through cJSON instead.
+// Returns false if the line is not a JSON object at all
+bool MetricsParser_parseLine(const char* line, size_t len, MetricRecord* record) {
+    if (!line || !record) return false;
+
+    MetricRecord_clear(record);
+    if (parseFlatObject(line, len, record)) return true;
+
+    MetricRecord_clear(record);
+    return parseWithCJSON(line, len, record);
+}
@@ -0,0 +1,62 @@
+#ifndef EXPML_METRICSPARSER_H
+#define EXPML_METRICSPARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct cJSON cJSON;
+typedef struct Arena_ Arena;
+
+// One numeric field of a metrics row. 'key' is a slice (not NUL-terminated) into the
+// parsed line, or into the fallback cJSON tree for lines the fast path rejected
+typedef struct MetricField_ {
+    const char* key;
+    size_t key_len;
+    double value;
+    const char* text;      // Unparsed number in the line when values are deferred, else NULL
+    size_t text_len;
+} MetricField;
+
+// A flat metrics row, reused line after line so parsing does not allocate per field
+typedef struct MetricRecord_ {
+    MetricField* fields;
+    size_t count;
+    size_t capacity;
+    int64_t step;          // "_step", or -1 when absent
+    double timestamp;      // "_timestamp", or 0.0 when absent
+    cJSON* fallback;       // Tree backing the keys of the last fallback-parsed line
+    Arena* arena;          // Holds the fallback tree; reset line by line
+    uint32_t* index;       // Scratch structural index, reused across lines
+    size_t index_capacity;
+    bool defer_values;     // Leave the numbers of flat rows as text; see MetricsParser_fieldValue
+} MetricRecord;
+
+// Prepares an empty record
+void MetricRecord_init(MetricRecord* record);
+
+// Releases the field buffer and the arena of any fallback tree held by the record
+void MetricRecord_done(MetricRecord* record);
+
+// Empties the record for the next line while keeping its field buffer
+void MetricRecord_clear(MetricRecord* record);
+
+// Appends a field, growing the reusable buffer geometrically when full.
+// "_step" and "_timestamp" are also copied into the record's bookkeeping fields
+bool MetricRecord_addField(MetricRecord* record, const char* key, size_t key_len, double value);
+
+// Returns the value of a field, parsing it now if it was deferred. Returns false if the
+// deferred text is not a number
+bool MetricsParser_fieldValue(const MetricField* field, double* value);
+
+// Converts a parsed "_step" number to a step, or -1 if it is not finite or out of int64 range
+int64_t MetricsParser_toStep(double value);
+
+// Parses one JSONL row into the record. Flat {"key": number, ...} rows are tokenized in
+// place from a SIMD structural index (see JsonScan); anything else (nested values, escaped keys) goes through cJSON instead.
+// With 'defer_values' set, the numbers of flat rows are only delimited, not parsed, except
+// for internal fields ("_step", "_timestamp"); a malformed one is then caught only when
+// its field's value is asked for. Returns false if the line is not a JSON object at all
+bool MetricsParser_parseLine(const char* line, size_t len, MetricRecord* record);
+
+#endif
@@ -207,6 +207,14 @@ int Panel_getItemCount(const Panel* this) {
     return this ? (int)this->item_count : 0;
 }
 
+// Number of items that fit below the header and the blank line after it
+int Panel_getVisibleCount(const Panel* this) {
+    if (!this) return 0;
+    int available_height = this->h - (this->header ? 2 : 1);
+    int visible_items = available_height / this->item_height;
+    return visible_items < 1 ? 1 : visible_items;
+}
+
 PanelItem* Panel_getItem(Panel* this, int index) {
     if (!this || index < 0 || index >= (int)this->item_count) { return NULL; }
     return &this->items[index];
@@ -300,8 +308,7 @@ void Panel_draw(Panel* this, bool force_redraw) {
     available_height--;
 
     int size = (int)this->item_count;
-    int visible_items = available_height / this->item_height;
-    if (visible_items < 1) visible_items = 1;
+    int visible_items = Panel_getVisibleCount(this);
 
     if (this->selected < this->scroll_v) {
         this->scroll_v = this->selected;
@@ -57,6 +57,7 @@ void Panel_insertItem(Panel* this, int index, const char* text, void* data);
 bool Panel_removeItem(Panel* this, int index);
 void Panel_clear(Panel* this);
 int Panel_getItemCount(const Panel* this);
+int Panel_getVisibleCount(const Panel* this);
 PanelItem* Panel_getItem(Panel* this, int index);
 PanelItem* Panel_getSelected(Panel* this);
 int Panel_getSelectedIndex(const Panel* this);
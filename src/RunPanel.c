@@ -77,9 +77,9 @@ static void addKV(Panel* p, const char* key, const char* val) {
     Panel_addItem(p, buffer, NULL);
 }
 
-static void addKI(Panel* p, const char* key, int val) {
+static void addKI(Panel* p, const char* key, long long val) {
     char buffer[256];
-    snprintf(buffer, sizeof(buffer), "%s\t%d", key, val);
+    snprintf(buffer, sizeof(buffer), "%s\t%lld", key, val);
     Panel_addItem(p, buffer, NULL);
 }
 
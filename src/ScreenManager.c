@@ -5,12 +5,33 @@
 #include "FunctionBar.h" 
 #include "ScreenManager.h"
 
+#include <poll.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
 #include <ncurses.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
+
+#ifdef __linux__
+#include <sys/signalfd.h>
+#endif
+
+// A burst of file writes is given this long to settle before the refresh it triggers
+#define WATCH_SETTLE_DELAY 0.01
+
+// File events never refresh more often than this, however fast the run logs
+#define WATCH_MIN_SPACING 0.1
+
+typedef struct ScreenWatch_ {
+    int fd;
+    ScreenManager_OnWatch callback;
+    void* userdata;
+} ScreenWatch;
 
 typedef struct PanelLayout_ {
     Panel* panel;
@@ -30,8 +51,11 @@ struct ScreenManager_ {
     FunctionBar* function_bar;
     double last_refresh;
     double refresh_interval;
+    double next_refresh;   // When the next refresh is due, 0 = none pending
     ScreenManager_OnRefresh on_refresh;
     void* refresh_userdata;
+    ScreenWatch* watches;  // Descriptors whose activity schedules a refresh
+    size_t watch_count;
 };
 
 // Returns current time in seconds with microsecond precision
@@ -89,10 +113,13 @@ ScreenManager* ScreenManager_new(const char* header_text, double refresh_interva
     this->show_help = false;
     this->function_bar = NULL;
     this->header = Header_new(header_text);
-    this->last_refresh = getCurrentTime();
+    this->last_refresh = 0.0;   // Nothing refreshed yet, so the first file event is not held back
     this->refresh_interval = refresh_interval > 0.0 ? refresh_interval : 1.0;
+    this->next_refresh = 0.0;
     this->on_refresh = NULL;
     this->refresh_userdata = NULL;
+    this->watches = NULL;
+    this->watch_count = 0;
     return this;
 }
 
@@ -108,6 +135,7 @@ void ScreenManager_delete(ScreenManager* this) {
     }
     
     free(this->layouts);
+    free(this->watches);
     free(this);
 }
 
@@ -281,6 +309,30 @@ void ScreenManager_setRefreshCallback(ScreenManager* this, ScreenManager_OnRefre
     }
 }
 
+// Registers a descriptor to wait on. When it becomes readable the callback is run, and a
+// true return schedules a refresh. Once any watch is registered, refreshes happen only on
+// such changes instead of every refresh interval. The caller keeps ownership of the fd
+void ScreenManager_addWatch(ScreenManager* this, int fd, ScreenManager_OnWatch callback, void* userdata) {
+    if (!this || fd < 0 || !callback) return;
+
+    ScreenWatch* watches = realloc(this->watches, (this->watch_count + 1) * sizeof(ScreenWatch));
+    if (!watches) return;
+    this->watches = watches;
+    this->watches[this->watch_count++] = (ScreenWatch){ fd, callback, userdata };
+}
+
+// Stops waiting on a descriptor registered with ScreenManager_addWatch. Safe to call from
+// a refresh callback; the descriptor is not closed
+void ScreenManager_removeWatch(ScreenManager* this, int fd) {
+    if (!this) return;
+    for (size_t i = 0; i < this->watch_count; i++) {
+        if (this->watches[i].fd != fd) continue;
+        memmove(&this->watches[i], &this->watches[i + 1], (this->watch_count - i - 1) * sizeof(ScreenWatch));
+        this->watch_count--;
+        return;
+    }
+}
+
 // Forces a complete redraw of the entire screen
 void ScreenManager_forceRedraw(ScreenManager* this) {
     if (!this) return;
@@ -304,7 +356,7 @@ void ScreenManager_forceRedraw(ScreenManager* this) {
 static void drawHelp(ScreenManager* this) {
     (void)this;  // Suppress unused parameter warning
     int w = 50;
-    int h = 16;
+    int h = 18;
     int x = (COLS - w) / 2;
     int y = (LINES - h) / 2;
 
@@ -347,6 +399,7 @@ static void drawHelp(ScreenManager* this) {
     mvprintw(text_y++, text_x, "  h            : Help");
     mvprintw(text_y++, text_x, "  q            : Quit");
     mvprintw(text_y++, text_x, "  Ctrl+L       : Force Redraw");
+    mvprintw(text_y++, text_x, "  x            : Chart Step / Time Axis");
     
     text_y++;
 
@@ -357,103 +410,158 @@ static void drawHelp(ScreenManager* this) {
     attroff(Terminal_colors[PANEL_BACKGROUND]);
 }
 
-// Main event loop - handles input, refresh, and rendering
-int ScreenManager_run(ScreenManager* this) {
-    if (!this) return -1;
-    bool force_redraw = true;
-    int ch = ERR;
+// Blocks SIGWINCH and returns a descriptor that becomes readable when it arrives, so a
+// resize wakes poll() directly. Returns -1 where unsupported; ncurses' own handler then
+// interrupts poll() and getch() reports KEY_RESIZE instead
+static int openResizeSignal(void) {
+#ifdef __linux__
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGWINCH);
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) return -1;
+
+    int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+// Closes the resize descriptor and lets SIGWINCH through to ncurses again
+static void closeResizeSignal(int fd) {
+#ifdef __linux__
+    if (fd < 0) return;
+    close(fd);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGWINCH);
+    pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+#else
+    (void)fd;
+#endif
+}
+
+// Consumes pending resize signals and tells ncurses the new terminal size, which it can no
+// longer learn on its own while SIGWINCH is blocked
+static void applyResizeSignal(int fd) {
+#ifdef __linux__
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {}
+
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        resizeterm(ws.ws_row, ws.ws_col);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+// Schedules a refresh for a file change: soon, but not sooner than the minimum spacing
+static void scheduleRefresh(ScreenManager* this, double now) {
+    double due = now + WATCH_SETTLE_DELAY;
+    if (due < this->last_refresh + WATCH_MIN_SPACING) due = this->last_refresh + WATCH_MIN_SPACING;
+    if (this->next_refresh == 0.0 || due < this->next_refresh) this->next_refresh = due;
+}
+
+// Handles one key press. Returns true if the screen needs a full redraw
+static bool handleKey(ScreenManager* this, int ch) {
+    bool force_redraw = false;
+
+    if (this->show_help) {
+        if (ch == KEY_RESIZE) {
+            ScreenManager_resize(this);
+        } else {
+            this->show_help = false;
+        }
+        return true;
+    }
+
+    bool handled = false;
+
+    // 1. Global Keys (Highest Priority)
+    if (ch == KEY_RESIZE) {
+        endwin();  // Temporarily exit ncurses mode
+        refresh(); // Restore it (this forces ncurses to re-read terminal dims)
+
+        Terminal_resetColors(); 
+        clear();
+        ScreenManager_resize(this);
+        force_redraw = true;
+        handled = true;
+    } else if (ch == 12) { // Ctrl+L (Force Redraw)
+        endwin();
+        refresh();
+        Terminal_resetColors(); // Restore RGB colors
+        clear();                // Wipe artifacts
+        ScreenManager_resize(this);
+        force_redraw = true;
+        handled = true;
+    } else if (ch == 'q') {
+        this->quit = true;
+        handled = true;
+    } else if (ch == 'h') {
+        this->show_help = true;
+        force_redraw = true;
+        handled = true;
+    } else if (ch == '\t') { 
+        size_t next = (this->focused + 1) % this->panel_count;
+        ScreenManager_setFocus(this, next);
+        force_redraw = true; 
+        handled = true;
+    }
+
+    // 2. Offer key to the Focused Panel (Edge Bumping Logic)
+    // If the panel uses the key (e.g., Metrics moving selection), it returns true.
+    // If the panel hits an edge or doesn't use it, it returns false.
+    if (!handled && this->panel_count > 0) {
+        Panel* p = this->layouts[this->focused].panel;
+        if (Panel_onKey(p, ch)) {
+            handled = true; // Panel consumed the key
+        }
+    }
     
-    while (!this->quit) {
-        timeout(100);
-        ch = Terminal_readKey();
-        
-        if (this->show_help) {
-            if (ch != ERR) {
-                if (ch == KEY_RESIZE) {
-                    ScreenManager_resize(this);
-                } else {
-                    this->show_help = false;
-                }
-                force_redraw = true;
-            }
-        } 
-        else if (ch != ERR) {
-            bool handled = false;
-            
-            // 1. Global Keys (Highest Priority)
-            if (ch == KEY_RESIZE) {
-                endwin();  // Temporarily exit ncurses mode
-                refresh(); // Restore it (this forces ncurses to re-read terminal dims)
-
-                Terminal_resetColors(); 
-                clear();
-                ScreenManager_resize(this);
+    // 3. ScreenManager Navigation (Fallback)
+    // If the panel ignored the arrow key (e.g., RunPanel, or Metrics at edge),
+    // we switch focus here.
+    if (!handled) {
+        if (ch == KEY_RIGHT && this->allow_focus_change) {
+             if (this->focused < this->panel_count - 1) {
+                ScreenManager_setFocus(this, this->focused + 1);
                 force_redraw = true;
-                handled = true;
-            } else if (ch == 12) { // Ctrl+L (Force Redraw)
-                endwin();
-                refresh();
-                Terminal_resetColors(); // Restore RGB colors
-                clear();                // Wipe artifacts
-                ScreenManager_resize(this);
+             }
+        } else if (ch == KEY_LEFT && this->allow_focus_change) {
+             if (this->focused > 0) {
+                ScreenManager_setFocus(this, this->focused - 1);
                 force_redraw = true;
-                handled = true;
-            } else if (ch == 'q') {
-                this->quit = true;
-                handled = true;
-            } else if (ch == 'h') {
-                this->show_help = true;
-                force_redraw = true;
-                handled = true;
-            } else if (ch == '\t') { 
-                size_t next = (this->focused + 1) % this->panel_count;
-                ScreenManager_setFocus(this, next);
-                force_redraw = true; 
-                handled = true;
-            }
-
-            // 2. Offer key to the Focused Panel (Edge Bumping Logic)
-            // If the panel uses the key (e.g., Metrics moving selection), it returns true.
-            // If the panel hits an edge or doesn't use it, it returns false.
-            if (!handled && this->panel_count > 0) {
-                Panel* p = this->layouts[this->focused].panel;
-                if (Panel_onKey(p, ch)) {
-                    handled = true; // Panel consumed the key
-                }
-            }
-            
-            // 3. ScreenManager Navigation (Fallback)
-            // If the panel ignored the arrow key (e.g., RunPanel, or Metrics at edge),
-            // we switch focus here.
-            if (!handled) {
-                if (ch == KEY_RIGHT && this->allow_focus_change) {
-                     if (this->focused < this->panel_count - 1) {
-                        ScreenManager_setFocus(this, this->focused + 1);
-                        force_redraw = true;
-                        handled = true;
-                     }
-                } else if (ch == KEY_LEFT && this->allow_focus_change) {
-                     if (this->focused > 0) {
-                        ScreenManager_setFocus(this, this->focused - 1);
-                        force_redraw = true;
-                        handled = true;
-                     }
-                }
-            }
+             }
         }
-        
-        // Check if it's time for a periodic refresh
-        double current_time = getCurrentTime();
-        if ((current_time - this->last_refresh) >= this->refresh_interval) { 
-            this->last_refresh = current_time;
+    }
+    return force_redraw;
+}
 
-            if (this->on_refresh) { this->on_refresh(this->refresh_userdata); }
-            for(size_t i=0; i<this->panel_count; i++) {
-                Panel_setNeedsRedraw(this->layouts[i].panel);
-            }
-            force_redraw = true;
-        }
-        
+// Main event loop - sleeps in poll() until a key, a resize, a watched file change or a
+// due refresh wakes it, so an idle screen costs no CPU
+int ScreenManager_run(ScreenManager* this) {
+    if (!this) return -1;
+
+    // Watches may come and go while running, so the poll set is sized on each pass
+    size_t fd_capacity = 2 + this->watch_count;
+    struct pollfd* fds = calloc(fd_capacity, sizeof(struct pollfd));
+    if (!fds) return -1;
+
+    int resize_fd = openResizeSignal();
+    bool force_redraw = true;
+
+    // poll() does all the waiting; getch() only collects what is already there
+    timeout(0);
+
+    // Without change notification, fall back to refreshing every interval
+    if (this->watch_count == 0) this->next_refresh = getCurrentTime() + this->refresh_interval;
+
+    while (!this->quit) {
         // Render everything
         Header_draw(this->header);
         drawInstructions();
@@ -466,7 +574,63 @@ int ScreenManager_run(ScreenManager* this) {
         if (this->show_help) { drawHelp(this); }
         refresh();
         force_redraw = false;
+
+        // Sleep until something happens or the next refresh is due
+        int wait_ms = -1;
+        if (this->next_refresh > 0.0) {
+            double left = this->next_refresh - getCurrentTime();
+            wait_ms = left > 0.0 ? (int)(left * 1000.0) + 1 : 0;
+        }
+
+        size_t fd_count = 2 + this->watch_count;
+        if (fd_count > fd_capacity) {
+            struct pollfd* grown = realloc(fds, fd_count * sizeof(struct pollfd));
+            if (!grown) break;
+            fds = grown;
+            fd_capacity = fd_count;
+        }
+        fds[0] = (struct pollfd){ .fd = STDIN_FILENO, .events = POLLIN };
+        fds[1] = (struct pollfd){ .fd = resize_fd, .events = POLLIN };
+        for (size_t i = 0; i < this->watch_count; i++) {
+            fds[2 + i] = (struct pollfd){ .fd = this->watches[i].fd, .events = POLLIN };
+        }
+        if (poll(fds, fd_count, wait_ms) < 0 && errno != EINTR) break;
+
+        // Keys ncurses has buffered may not show up as stdin activity, so always drain them
+        int ch;
+        while (!this->quit && (ch = Terminal_readKey()) != ERR) {
+            if (handleKey(this, ch)) force_redraw = true;
+        }
+        if (this->quit) break;
+
+        if (fds[1].revents & POLLIN) {
+            applyResizeSignal(resize_fd);
+            if (handleKey(this, KEY_RESIZE)) force_redraw = true;
+        }
+
+        double current_time = getCurrentTime();
+        for (size_t i = 0; i < this->watch_count; i++) {
+            if (!(fds[2 + i].revents & POLLIN)) continue;
+            if (this->watches[i].callback(this->watches[i].fd, this->watches[i].userdata)) {
+                scheduleRefresh(this, current_time);
+            }
+        }
+
+        // Run the refresh once it is due
+        if (this->next_refresh > 0.0 && current_time >= this->next_refresh) {
+            this->last_refresh = current_time;
+            this->next_refresh = this->watch_count == 0 ? current_time + this->refresh_interval : 0.0;
+
+            if (this->on_refresh) { this->on_refresh(this->refresh_userdata); }
+            for(size_t i=0; i<this->panel_count; i++) {
+                Panel_setNeedsRedraw(this->layouts[i].panel);
+            }
+            force_redraw = true;
+        }
     }
+
+    closeResizeSignal(resize_fd);
+    free(fds);
     return 0;
 }
 
@@ -32,6 +32,9 @@ size_t ScreenManager_getPanelCount(const ScreenManager* this);
 Panel* ScreenManager_getPanel(const ScreenManager* this, size_t index);
 typedef void (*ScreenManager_OnRefresh)(void* userdata);
 void ScreenManager_setRefreshCallback(ScreenManager* this, ScreenManager_OnRefresh callback, void* userdata);
+typedef bool (*ScreenManager_OnWatch)(int fd, void* userdata);
+void ScreenManager_addWatch(ScreenManager* this, int fd, ScreenManager_OnWatch callback, void* userdata);
+void ScreenManager_removeWatch(ScreenManager* this, int fd);
 void ScreenManager_setStartTime(ScreenManager* this, const char* time);
 void ScreenManager_setEndTime(ScreenManager* this, const char* time);
 void ScreenManager_setHeaderStatus(ScreenManager* this, const char* status);
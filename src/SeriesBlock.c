@@ -0,0 +1,253 @@
+#include "SeriesBlock.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Worst case bits per point: a 4-bit prefix plus a raw 64-bit delta for steps and for
+// timestamps, and a 2-bit prefix, two 6-bit fields and 64 bits for a value
+#define MAX_POINT_BITS (68 + 68 + 78)
+#define MAX_HEADER_BITS (3 * 64)
+
+// Bits are packed least significant first into 64-bit words
+typedef struct {
+    uint64_t* words;
+    size_t bit;
+} BitStream;
+
+static void putBits(BitStream* w, uint64_t value, int n) {
+    if (n < 64) value &= (UINT64_C(1) << n) - 1;
+    size_t word = w->bit >> 6;
+    int used = (int)(w->bit & 63);
+    w->words[word] |= value << used;
+    if (used + n > 64) w->words[word + 1] |= value >> (64 - used);
+    w->bit += n;
+}
+
+static uint64_t getBits(BitStream* r, int n) {
+    size_t word = r->bit >> 6;
+    int used = (int)(r->bit & 63);
+    uint64_t value = r->words[word] >> used;
+    if (used + n > 64) value |= r->words[word + 1] << (64 - used);
+    r->bit += n;
+    return n < 64 ? value & ((UINT64_C(1) << n) - 1) : value;
+}
+
+static uint64_t bitsOf(double d) {
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+static double doubleOf(uint64_t u) {
+    double d;
+    memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+// Delta-of-delta code: '0' for zero, otherwise a unary width class ('10', '110', '1110',
+// '1111') followed by the zigzagged difference in 8, 16, 32 or 64 bits. Arithmetic is
+// modulo 2^64, so any int64 sequence (or double bit pattern) round-trips exactly
+static void putDelta(BitStream* w, uint64_t dod) {
+    uint64_t zz = (dod << 1) ^ (UINT64_C(0) - (dod >> 63));
+    if (zz == 0) {
+        putBits(w, 0x0, 1);
+    } else if (zz < (UINT64_C(1) << 8)) {
+        putBits(w, 0x1, 2);
+        putBits(w, zz, 8);
+    } else if (zz < (UINT64_C(1) << 16)) {
+        putBits(w, 0x3, 3);
+        putBits(w, zz, 16);
+    } else if (zz < (UINT64_C(1) << 32)) {
+        putBits(w, 0x7, 4);
+        putBits(w, zz, 32);
+    } else {
+        putBits(w, 0xF, 4);
+        putBits(w, zz, 64);
+    }
+}
+
+static uint64_t getDelta(BitStream* r) {
+    int width;
+    if (!getBits(r, 1)) return 0;
+    if (!getBits(r, 1)) {
+        width = 8;
+    } else if (!getBits(r, 1)) {
+        width = 16;
+    } else {
+        width = getBits(r, 1) ? 64 : 32;
+    }
+    uint64_t zz = getBits(r, width);
+    return (zz >> 1) ^ (UINT64_C(0) - (zz & 1));
+}
+
+// Codes a column of 64-bit integers (steps, or timestamp bit patterns) as its first entry
+// followed by delta-of-deltas
+static void putIntegers(BitStream* w, const uint64_t* in, int count) {
+    uint64_t prev = in[0];
+    uint64_t prev_delta = 0;
+    putBits(w, prev, 64);
+    for (int i = 1; i < count; i++) {
+        uint64_t cur = in[i];
+        uint64_t delta = cur - prev;
+        putDelta(w, delta - prev_delta);
+        prev = cur;
+        prev_delta = delta;
+    }
+}
+
+static void getIntegers(BitStream* r, uint64_t* out, int count) {
+    uint64_t prev = getBits(r, 64);
+    uint64_t delta = 0;
+    out[0] = prev;
+    for (int i = 1; i < count; i++) {
+        delta += getDelta(r);
+        prev += delta;
+        out[i] = prev;
+    }
+}
+
+// Codes values as the XOR against the previous one: '0' if unchanged, '10' plus the
+// meaningful bits if they fit the previous leading/trailing zero window, otherwise '11',
+// the new window (6-bit leading zeros, 6-bit length - 1) and the meaningful bits
+static void putValues(BitStream* w, const double* values, int count) {
+    uint64_t prev = bitsOf(values[0]);
+    int prev_lead = -1, prev_trail = 0;
+    putBits(w, prev, 64);
+    for (int i = 1; i < count; i++) {
+        uint64_t cur = bitsOf(values[i]);
+        uint64_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            putBits(w, 0x0, 1);
+            continue;
+        }
+
+        int lead = __builtin_clzll(x);
+        int trail = __builtin_ctzll(x);
+        if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail) {
+            putBits(w, 0x1, 2);
+            putBits(w, x >> prev_trail, 64 - prev_lead - prev_trail);
+        } else {
+            int meaningful = 64 - lead - trail;
+            putBits(w, 0x3, 2);
+            putBits(w, (uint64_t)lead, 6);
+            putBits(w, (uint64_t)(meaningful - 1), 6);
+            putBits(w, x >> trail, meaningful);
+            prev_lead = lead;
+            prev_trail = trail;
+        }
+    }
+}
+
+static void getValues(BitStream* r, double* values, int count) {
+    uint64_t prev = getBits(r, 64);
+    int lead = 0, trail = 0;
+    values[0] = doubleOf(prev);
+    for (int i = 1; i < count; i++) {
+        if (getBits(r, 1)) {
+            if (getBits(r, 1)) {
+                lead = (int)getBits(r, 6);
+                trail = 64 - lead - ((int)getBits(r, 6) + 1);
+            }
+            prev ^= getBits(r, 64 - lead - trail) << trail;
+        }
+        values[i] = doubleOf(prev);
+    }
+}
+
+// Compresses 'count' (1..SERIES_BLOCK_POINTS) points into a new block with one reference.
+// Returns NULL on allocation failure
+SeriesBlock* SeriesBlock_encode(const int64_t* steps, const double* timestamps, const double* values, int count) {
+    if (count <= 0 || count > SERIES_BLOCK_POINTS) return NULL;
+
+    size_t max_words = ((size_t)count * MAX_POINT_BITS + MAX_HEADER_BITS + 63) / 64;
+    SeriesBlock* block = calloc(1, sizeof(SeriesBlock) + max_words * sizeof(uint64_t));
+    if (!block) return NULL;
+
+    block->refcount = 1;
+    block->count = count;
+    block->first_step = steps[0];
+    block->last_step = steps[count - 1];
+
+    bool linear = true;
+    uint64_t stride = count > 1 ? (uint64_t)steps[1] - (uint64_t)steps[0] : 0;
+    for (int i = 2; i < count && linear; i++) linear = (uint64_t)steps[i] - (uint64_t)steps[i - 1] == stride;
+
+    bool constant = true;
+    uint64_t first_value = bitsOf(values[0]);
+    for (int i = 1; i < count && constant; i++) constant = bitsOf(values[i]) == first_value;
+
+    BitStream w = { block->words, 0 };
+    if (linear) {
+        block->flags |= BLOCK_LINEAR_STEPS;
+        putBits(&w, (uint64_t)steps[0], 64);
+        putBits(&w, stride, 64);
+    } else {
+        putIntegers(&w, (const uint64_t*)steps, count);
+    }
+
+    block->timestamp_bit = w.bit;
+    uint64_t stamp_bits[SERIES_BLOCK_POINTS];
+    memcpy(stamp_bits, timestamps, count * sizeof(uint64_t));
+    putIntegers(&w, stamp_bits, count);
+
+    block->value_bit = w.bit;
+    if (constant) {
+        block->flags |= BLOCK_CONSTANT_VALUES;
+        putBits(&w, first_value, 64);
+    } else {
+        putValues(&w, values, count);
+    }
+
+    // Give back the worst-case slack
+    block->word_count = (w.bit + 63) / 64;
+    SeriesBlock* shrunk = realloc(block, sizeof(SeriesBlock) + block->word_count * sizeof(uint64_t));
+    return shrunk ? shrunk : block;
+}
+
+// Expands a block into arrays of block->count entries. Any output may be NULL, in which
+// case that column's section is not decoded
+void SeriesBlock_decode(const SeriesBlock* block, int64_t* steps, double* timestamps, double* values) {
+    if (!block) return;
+    int count = block->count;
+    uint64_t* words = (uint64_t*)block->words;
+
+    // Fixed strides and constants expand with plain loops the compiler can vectorize
+    if (steps) {
+        BitStream r = { words, 0 };
+        if (block->flags & BLOCK_LINEAR_STEPS) {
+            uint64_t first = getBits(&r, 64);
+            uint64_t stride = getBits(&r, 64);
+            for (int i = 0; i < count; i++) steps[i] = (int64_t)(first + (uint64_t)i * stride);
+        } else {
+            getIntegers(&r, (uint64_t*)steps, count);
+        }
+    }
+    if (timestamps) {
+        BitStream r = { words, block->timestamp_bit };
+        uint64_t stamp_bits[SERIES_BLOCK_POINTS];
+        getIntegers(&r, stamp_bits, count);
+        memcpy(timestamps, stamp_bits, count * sizeof(uint64_t));
+    }
+    if (values) {
+        BitStream r = { words, block->value_bit };
+        if (block->flags & BLOCK_CONSTANT_VALUES) {
+            double value = doubleOf(getBits(&r, 64));
+            for (int i = 0; i < count; i++) values[i] = value;
+        } else {
+            getValues(&r, values, count);
+        }
+    }
+}
+
+// Takes another reference on a block
+SeriesBlock* SeriesBlock_retain(SeriesBlock* block) {
+    if (block) block->refcount++;
+    return block;
+}
+
+// Drops a reference, freeing the block with the last one
+void SeriesBlock_release(SeriesBlock* block) {
+    if (block && --block->refcount == 0) free(block);
+}
@@ -0,0 +1,44 @@
+#ifndef EXPML_SERIESBLOCK_H
+#define EXPML_SERIESBLOCK_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Points per sealed block (the last block of a series may hold fewer while it is open)
+#define SERIES_BLOCK_POINTS 1024
+
+// Block layout flags
+#define BLOCK_LINEAR_STEPS    0x1   // Steps advance by a fixed stride; only first step and stride stored
+#define BLOCK_CONSTANT_VALUES 0x2   // Every value is bitwise identical; only the first is stored
+
+// An immutable, compressed run of step-ordered points. Steps and timestamps are coded as
+// delta-of-deltas, values as the XOR against their predecessor (Gorilla style), each column
+// in its own section of one bit stream so a column can be decoded without the others
+typedef struct SeriesBlock_ {
+    atomic_int refcount;   // Blocks are shared by columns on the loader and UI threads
+    int count;
+    int flags;
+    int64_t first_step;
+    int64_t last_step;
+    size_t timestamp_bit;  // Bit offset of the timestamp section; steps start at 0
+    size_t value_bit;      // Bit offset of the value section
+    size_t word_count;
+    uint64_t words[];
+} SeriesBlock;
+
+// Compresses 'count' (1..SERIES_BLOCK_POINTS) points into a new block with one reference.
+// Returns NULL on allocation failure
+SeriesBlock* SeriesBlock_encode(const int64_t* steps, const double* timestamps, const double* values, int count);
+
+// Expands a block into arrays of block->count entries. Any output may be NULL, in which
+// case that column's section is not decoded
+void SeriesBlock_decode(const SeriesBlock* block, int64_t* steps, double* timestamps, double* values);
+
+// Takes another reference on a block
+SeriesBlock* SeriesBlock_retain(SeriesBlock* block);
+
+// Drops a reference, freeing the block with the last one
+void SeriesBlock_release(SeriesBlock* block);
+
+#endif
@@ -32,35 +32,49 @@ static void draw_virtual_line(unsigned char* grid, int w, int h, int x0, int y0,
     }
 }
 
-void Sparkline_draw(const float* values, size_t count, int y, int x, int width, int height, int color) {
-    if (!values || count == 0) return;
-
-    // 1. Calculate Min/Max for scaling
-    float min = values[0];
-    float max = values[0];
-    for (size_t i = 1; i < count; i++) {
-        if (values[i] < min) min = values[i];
-        if (values[i] > max) max = values[i];
-    }
-    float range = max - min;
-    if (range == 0) range = 1.0f;
+// Prepares an empty width x height chart mapping [x_min, x_max] and [y_min, y_max] onto its
+// dots. Returns false on allocation failure
+bool Sparkline_begin(Sparkline* this, int width, int height, double x_min, double x_max, double y_min, double y_max) {
+    memset(this, 0, sizeof(Sparkline));
+    if (width <= 0 || height <= 0) return false;
 
-    // 2. Setup Virtual Grid (2x width, 4x height)
-    int v_width = width * 2;
-    int v_height = height * 4;
-    
+    // Setup Virtual Grid (2x width, 4x height)
     // Use calloc so the grid is zeroed out immediately
-    unsigned char* grid = calloc(v_width * v_height, sizeof(unsigned char));
-    if (!grid) return;
+    this->grid = calloc((size_t)width * 2 * height * 4, sizeof(unsigned char));
+    if (!this->grid) return false;
+
+    this->width = width;
+    this->height = height;
+    this->x_min = x_min;
+    this->x_range = x_max - x_min;
+    this->y_min = y_min;
+    this->y_range = y_max - y_min;
+    if (this->y_range == 0) this->y_range = 1.0;
+    this->prev_vx = -1;
+    this->prev_vy = -1;
+    return true;
+}
 
-    // 3. PURE SPATIAL BINNING (The "Go" Logic)
+// Plots the next 'count' points, continuing the line from the previous batch. Point i is
+// placed horizontally by steps[i], or by timestamps[i] if 'steps' is NULL (by its overall
+// index if both are NULL). Non-finite values break the line
+void Sparkline_plot(Sparkline* this, const double* values, const int64_t* steps, const double* timestamps, size_t count) {
+    if (!this->grid || !values) return;
+
+    int v_width = this->width * 2;
+    int v_height = this->height * 4;
+    unsigned char* grid = this->grid;
+    double x_min = this->x_min;
+    double x_range = this->x_range;
+    int prev_vx = this->prev_vx;
+    int prev_vy = this->prev_vy;
+
+    // PURE SPATIAL BINNING (The "Go" Logic)
     // No "smart sampling" loops. No buckets. 
     // Just project every point and connect them.
-    
-    int prev_vx = -1;
-    int prev_vy = -1;
-
     for (size_t i = 0; i < count; i++) {
+        size_t index = this->index + i;
+
         // If metric is NaN or Inf, skip it to avoid crashes or wild drawing
         if (!isfinite(values[i])) {
             // Optional: Break the line by resetting prev pointers
@@ -69,23 +83,23 @@ void Sparkline_draw(const float* values, size_t count, int y, int x, int width,
             continue;
         }
         
-        // Project X: map index to virtual width
-        int vx = (int)((double)i * (v_width - 1) / (count - 1));
+        // Project X: map the point's step (or time) to virtual width
+        double px = steps ? (double)steps[i] : (timestamps ? timestamps[i] : (double)index);
+        double fx = x_range > 0 ? (px - x_min) * (v_width - 1) / x_range : 0;
         
         // Project Y: map value to virtual height
         // Note: 0 is bottom in grid logic, so we map directly.
-        float norm = (values[i] - min) / range;
-        int vy = (int)(norm * (v_height - 1));
+        double norm = (values[i] - this->y_min) / this->y_range;
+        double fy = norm * (v_height - 1);
 
-        // Clamp coordinates (safety)
-        if (vx < 0) vx = 0;
-        if (vx >= v_width) vx = v_width - 1;
-        if (vy < 0) vy = 0;
-        if (vy >= v_height) vy = v_height - 1;
+        // Clamp while still in floating point: a far-off step or value (or a NaN
+        // timestamp) would not fit an int, and converting it would be undefined
+        int vx = fx > 0 ? (fx < v_width - 1 ? (int)fx : v_width - 1) : 0;
+        int vy = fy > 0 ? (fy < v_height - 1 ? (int)fy : v_height - 1) : 0;
 
         // Draw
-        if (i == 0) {
-            // First point, just set the pixel
+        if (prev_vx < 0) {
+            // First point (or first after a gap), just set the pixel
             grid[vy * v_width + vx] = 1;
         } else {
             // Optimization: Only draw if the point moved in the grid.
@@ -99,47 +113,80 @@ void Sparkline_draw(const float* values, size_t count, int y, int x, int width,
         prev_vy = vy;
     }
 
-    // 4. Render Grid to Braille Characters
-    attron(color);
+    this->index += count;
+    this->prev_vx = prev_vx;
+    this->prev_vy = prev_vy;
+}
+
+// Writes the dots plotted so far as braille cells, width x height bytes row by row from the
+// top, each holding one cell's dot bits. The chart stays open for more points
+void Sparkline_rasterize(const Sparkline* this, unsigned char* cells) {
+    if (!this->grid) return;
+
+    int width = this->width;
+    int height = this->height;
+    int v_width = width * 2;
+    const unsigned char* grid = this->grid;
+
     for (int row = 0; row < height; row++) {
+        // Visual row 0 is the top of the screen, but in the grid high y is high value;
+        // so this cell row covers grid rows bottom + 3 (its top dots) down to bottom
+        int grid_block_bottom = (height - 1 - row) * 4;
         for (int col = 0; col < width; col++) {
-            int braille_char = 0x2800;
+            int bits = 0;
 
             // Check the 2x4 block
             for (int sub_x = 0; sub_x < 2; sub_x++) {
+                int vx = (col * 2) + sub_x;
                 for (int sub_y = 0; sub_y < 4; sub_y++) {
-                    int vx = (col * 2) + sub_x;
-                    
-                    // Coordinate mapping:
-                    // Visual Row 0 is the TOP of the screen.
-                    // But in our grid, high Y = high value (TOP).
-                    // So we need to map Visual Top to Grid Top.
-                    
-                    int grid_block_bottom = (height - 1 - row) * 4; 
                     int vy = grid_block_bottom + (3 - sub_y);
-
-                    if (vx < v_width && vy < v_height && vy >= 0) {
-                        if (grid[vy * v_width + vx]) {
-                            braille_char |= BRAILLE_MAP[sub_y][sub_x];
-                        }
-                    }
+                    if (grid[vy * v_width + vx]) bits |= BRAILLE_MAP[sub_y][sub_x];
                 }
             }
+            cells[row * width + col] = (unsigned char)bits;
+        }
+    }
+}
 
-            if (braille_char == 0x2800) {
+// Draws cells made by Sparkline_rasterize with the top-left cell at (y, x)
+void Sparkline_blit(const unsigned char* cells, int width, int height, int y, int x, int color) {
+    attron(color);
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            int bits = cells[row * width + col];
+            if (bits == 0) {
                 mvaddch(y + row, x + col, ' ');
-            } else {
-                char utf8[4];
-                // Standard Braille Unicode offset
-                utf8[0] = 0xE2;
-                utf8[1] = 0xA0 | ((braille_char >> 6) & 0x03);
-                utf8[2] = 0x80 | (braille_char & 0x3F);
-                utf8[3] = '\0';
-                mvprintw(y + row, x + col, "%s", utf8);
+                continue;
             }
+
+            // Braille patterns start at U+2800; the dot bits are the low byte
+            int braille_char = 0x2800 | bits;
+            char utf8[4];
+            utf8[0] = 0xE2;
+            utf8[1] = 0xA0 | ((braille_char >> 6) & 0x03);
+            utf8[2] = 0x80 | (braille_char & 0x3F);
+            utf8[3] = '\0';
+            mvaddstr(y + row, x + col, utf8);
         }
     }
-
     attroff(color);
-    free(grid);
-}
\ No newline at end of file
+}
+
+// Frees the chart's dots without drawing them
+void Sparkline_free(Sparkline* this) {
+    free(this->grid);
+    this->grid = NULL;
+}
+
+// Renders the chart with its top-left cell at (y, x) and frees it
+void Sparkline_finish(Sparkline* this, int y, int x, int color) {
+    if (!this->grid) return;
+
+    unsigned char* cells = malloc((size_t)this->width * this->height);
+    if (cells) {
+        Sparkline_rasterize(this, cells);
+        Sparkline_blit(cells, this->width, this->height, y, x, color);
+        free(cells);
+    }
+    Sparkline_free(this);
+}
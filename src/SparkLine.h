@@ -1,8 +1,45 @@
 #ifndef EXPML_SPARKLINE_H
 #define EXPML_SPARKLINE_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-void Sparkline_draw(const float* values, size_t count, int y, int x, int width, int height, int color);
+// A braille chart being drawn. Points are projected onto a sub-cell grid as they are fed
+// in, so a long series can be plotted a block at a time without being expanded in full
+typedef struct Sparkline_ {
+    unsigned char* grid;   // 2 x 4 dots per cell
+    int width;             // In cells
+    int height;
+    double x_min;
+    double x_range;
+    double y_min;
+    double y_range;
+    size_t index;          // Points fed so far, for charts placed by index
+    int prev_vx;           // Last dot drawn, or -1 after a gap
+    int prev_vy;
+} Sparkline;
+
+// Prepares an empty width x height chart mapping [x_min, x_max] and [y_min, y_max] onto its
+// dots. Returns false on allocation failure
+bool Sparkline_begin(Sparkline* this, int width, int height, double x_min, double x_max, double y_min, double y_max);
+
+// Plots the next 'count' points, continuing the line from the previous batch. Point i is
+// placed horizontally by steps[i], or by timestamps[i] if 'steps' is NULL (by its overall
+// index if both are NULL). Non-finite values break the line
+void Sparkline_plot(Sparkline* this, const double* values, const int64_t* steps, const double* timestamps, size_t count);
+
+// Writes the dots plotted so far as braille cells, width x height bytes row by row from the
+// top, each holding one cell's dot bits. The chart stays open for more points
+void Sparkline_rasterize(const Sparkline* this, unsigned char* cells);
+
+// Draws cells made by Sparkline_rasterize with the top-left cell at (y, x)
+void Sparkline_blit(const unsigned char* cells, int width, int height, int y, int x, int color);
+
+// Frees the chart's dots without drawing them
+void Sparkline_free(Sparkline* this);
+
+// Renders the chart with its top-left cell at (y, x) and frees it
+void Sparkline_finish(Sparkline* this, int y, int x, int color);
 
 #endif
\ No newline at end of file
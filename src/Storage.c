@@ -1,19 +1,131 @@
 #define _POSIX_C_SOURCE 200809L 
+#ifdef __linux__
+#define _GNU_SOURCE   // mremap
+#endif
 
 #include "Storage.h"
+#include "FastFloat.h"
+#include "Arena.h"
 
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
+#include <fcntl.h>
 #include <cjson/cJSON.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#define METRICS_FILENAME "metrics.jsonl"
+#define BINARY_METRICS_FILENAME "metrics.expb"
+#define SIDECAR_MAGIC "EXPC"
+#define SIDECAR_VERSION 2   // 2: values widened from f32 to f64
+#define SIDECAR_BYTE_ORDER 0x01020304u
+#define SIDECAR_ALIGN(x) (((x) + 7) & ~(uint64_t)7)
+#define STEP_INDEX_MAGIC "EXPI"
+#define STEP_INDEX_VERSION 1
+#define STEP_INDEX_INTERVAL (64 * 1024)   // Bytes of metrics between index entries
+#define KEYS_MANIFEST_FILENAME "keys.json"
+#define KEYS_MANIFEST_VERSION 2   // 2: stats cover several streams
+#define STREAMS_MANIFEST_FILENAME "streams.json"
+#define STREAMS_MANIFEST_VERSION 1
+#define STREAM_NAME_MAX 64
+#define JSON_ARENA_MIN 1024   // Parsed trees take several times their text; see parseJsonFile
+
+// Binary metrics layout written by expml.writer (little-endian): an 8-byte file header
+// ("EXPB", u32 version) followed by records of u8 type, 3 pad bytes, u32 payload length,
+// the payload and a u32 commit marker. 'K' records define keys as (u32 id, u16 len, name),
+// 'R' records hold one row as (u32 key id, f64 value) pairs
+#define BINARY_MAGIC "EXPB"
+#define BINARY_VERSION 1
+#define BINARY_HEADER_SIZE 8
+#define BINARY_RECORD_HEADER_SIZE 8
+#define BINARY_COMMIT_SIZE 4
+#define BINARY_COMMIT_MARKER 0x54494D43u
+#define BINARY_RECORD_KEYS 'K'
+#define BINARY_RECORD_ROW 'R'
+#define BINARY_FIELD_SIZE 12
+#define BINARY_MAX_PAYLOAD (64u << 20)
+
+// On-disk sidecar layout (native byte order, all offsets from the start of the file):
+// header, one directory entry per key, key names, then per key the steps (int64),
+// timestamps (f64) and values (f64) columns, each 8-byte aligned
+typedef struct SidecarHeader_ {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t column_count;
+    uint64_t source_dev;
+    uint64_t source_ino;
+    int64_t source_size;       // Bytes of the metrics file the columns cover (a row boundary)
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+} SidecarHeader;
+
+typedef struct SidecarEntry_ {
+    uint64_t name_offset;
+    uint64_t name_len;
+    uint64_t count;
+    uint64_t steps_offset;
+    uint64_t timestamps_offset;
+    uint64_t values_offset;
+} SidecarEntry;
+
+// On-disk step index layout (native byte order): header, then 'entry_count' entries
+typedef struct StepIndexHeader_ {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t interval;
+    uint64_t source_dev;
+    uint64_t source_ino;
+    int64_t source_size;       // Bytes of metrics.jsonl the index covers (a line boundary)
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    int64_t max_step;
+    uint64_t entry_count;
+} StepIndexHeader;
+
+// A line boundary in metrics.jsonl and the highest _step of all rows before it
+typedef struct StepIndexEntry_ {
+    int64_t offset;
+    int64_t max_step;
+} StepIndexEntry;
+
 typedef struct MetricsHandle_ {
+    char* path;
     FILE* file;
-    char* line_buffer;
+    dev_t dev;
+    ino_t ino;
+    off_t committed;       // Byte offset just past the last complete line or record consumed
+    MetricsReadMode mode;
+    const char* map;       // METRICS_READ_MMAP: read-only mapping of [0, map_size)
+    size_t map_size;
+    char* line_buffer;     // METRICS_READ_STDIO: getline() buffer (raw record bytes if binary)
     size_t buffer_size;
+    bool binary;           // Reading metrics.expb rather than metrics.jsonl
+    char** key_names;      // Binary key dictionary, indexed by the writer's key id
+    size_t* key_lens;
+    uint32_t key_count;
+    uint32_t key_capacity;
+    char* sidecar_path;    // metrics.expc, or the stream's own
+    char* index_path;      // metrics.sidx (or the stream's own), loaded lazily on first use
+    bool index_loaded;
+    StepIndexEntry* index; // Sparse _step -> offset entries, about STEP_INDEX_INTERVAL apart
+    size_t index_count;
+    size_t index_capacity;
+    off_t index_end;       // Lines before this offset have been indexed
+    off_t index_saved;     // How much of the file the index on disk covers
+    int64_t index_max_step;  // Highest _step among the indexed lines, or -1
 } MetricsHandle;
 
 // Reads entire file content into a dynamically allocated string
@@ -21,17 +133,19 @@ static char* readFileToString(const char* filepath) {
     FILE* f = fopen(filepath, "r");
     if (!f) return NULL;
     
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    if (size < 0) { fclose(f); return NULL; }
+    // off_t from fstat rather than a long from ftell, which is 32 bits on some platforms
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size < 0 || (uintmax_t)st.st_size >= SIZE_MAX) {
+        fclose(f);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
 
-    char* content = malloc((size_t)size + 1);
+    char* content = malloc(size + 1);
     if (!content) { fclose(f); return NULL; }
     
     // Read up to 'size' bytes to prevent overflow if file grew
-    size_t read = fread(content, 1, (size_t)size, f);
+    size_t read = fread(content, 1, size, f);
     content[read] = '\0';
     fclose(f);
     return content;
@@ -66,6 +180,59 @@ static char* buildPath(const char* dir, const char* filename) {
     return path;
 }
 
+// Parses the JSON file 'name' of 'run_dir' into a tree allocated from a new arena, so a
+// tree costs a couple of heap blocks instead of a malloc per node and string. Returns NULL
+// (and no arena) if the file is missing or not JSON; otherwise the caller releases the tree
+// by deleting '*arena'
+static cJSON* parseJsonFile(const char* run_dir, const char* name, Arena** arena) {
+    *arena = NULL;
+    char* path = buildPath(run_dir, name);
+    if (!path) return NULL;
+
+    char* content = readFileToString(path);
+    free(path);
+    if (!content) return NULL;
+
+    // A node is several times the size of the text it came from; start with room for that
+    *arena = Arena_new(strlen(content) * 4 + JSON_ARENA_MIN);
+    cJSON* json = NULL;
+    if (*arena) {
+        Arena* previous = Arena_useForJson(*arena);
+        json = cJSON_Parse(content);
+        Arena_useForJson(previous);
+    }
+    free(content);
+
+    if (!json) {
+        Arena_delete(*arena);
+        *arena = NULL;
+    }
+    return json;
+}
+
+// Returns true if 'name' can name a namespace stream: it becomes part of file names, so
+// only letters, digits, '_' and '-' are allowed
+static bool isStreamName(const char* name) {
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len > STREAM_NAME_MAX) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_' && name[i] != '-') return false;
+    }
+    return true;
+}
+
+// Builds the path of one of a stream's files: metrics<suffix> for the main stream (NULL or
+// empty), metrics.<stream><suffix> for a namespace stream
+static char* buildStreamPath(const char* run_dir, const char* stream, const char* suffix) {
+    char name[STREAM_NAME_MAX + 32];
+    if (stream && *stream) {
+        snprintf(name, sizeof(name), "metrics.%s%s", stream, suffix);
+    } else {
+        snprintf(name, sizeof(name), "metrics%s", suffix);
+    }
+    return buildPath(run_dir, name);
+}
+
 // Extracts a string value from JSON object, returns duplicate or default
 static char* getJsonString(cJSON* root, const char* key, const char* def) {
     cJSON* item = cJSON_GetObjectItem(root, key);
@@ -80,6 +247,14 @@ static int getJsonInt(cJSON* root, const char* key, int def) {
     return def;
 }
 
+// Extracts a 64-bit integer (a step, count or offset) from JSON object, returns value or
+// default. valueint would saturate at INT_MAX
+static int64_t getJsonInt64(cJSON* root, const char* key, int64_t def) {
+    cJSON* item = cJSON_GetObjectItem(root, key);
+    if (item && cJSON_IsNumber(item)) { return MetricsParser_toStep(item->valuedouble); }
+    return def;
+}
+
 // Extracts a double value from JSON object, returns value or default
 static double getJsonDouble(cJSON* root, const char* key, double def) {
     cJSON* item = cJSON_GetObjectItem(root, key);
@@ -127,49 +302,36 @@ char* Storage_findLatestRun(const char* expml_dir) {
 
 // Reads and returns the configuration for a specific run
 RunConfig* Storage_readConfig(const char* run_dir) {
-    char* path = buildPath(run_dir, "config.json");
-    if (!path) return NULL;
-    
-    char* content = readFileToString(path);
-    free(path);
-    if (!content) return NULL;
-
-    cJSON* json = cJSON_Parse(content);
-    free(content);
+    Arena* arena;
+    cJSON* json = parseJsonFile(run_dir, "config.json", &arena);
     if (!json) return NULL;
 
     RunConfig* config = calloc(1, sizeof(RunConfig));
     if (!config) {
-        cJSON_Delete(json);
+        Arena_delete(arena);
         return NULL;
     }
     
     config->json = json;
+    config->arena = arena;
     return config;
 }
 
 // Frees memory allocated for a RunConfig structure
 void Storage_freeRunConfig(RunConfig* config) {
     if (!config) return;
-    if (config->json) cJSON_Delete(config->json);
+    Arena_delete(config->arena);
     free(config);
 }
 
 // Reads and returns the metadata for a specific run
 RunMetadata* Storage_readMetadata(const char* run_dir) {
-    char* path = buildPath(run_dir, "metadata.json");
-    if (!path) return NULL;
-    
-    char* content = readFileToString(path);
-    free(path);
-    if (!content) return NULL;
-
-    cJSON* json = cJSON_Parse(content);
-    free(content);
+    Arena* arena;
+    cJSON* json = parseJsonFile(run_dir, "metadata.json", &arena);
     if (!json) return NULL;
 
     RunMetadata* meta = calloc(1, sizeof(RunMetadata));
-    if (!meta) { cJSON_Delete(json); return NULL; }
+    if (!meta) { Arena_delete(arena); return NULL; }
 
     // Extract all string fields with defaults
     meta->run_id = getJsonString(json, "id", "unknown");
@@ -190,7 +352,7 @@ RunMetadata* Storage_readMetadata(const char* run_dir) {
 
     // Check if any required allocation failed (run_id and run_name have defaults)
     if (!meta->run_id || !meta->run_name) {
-        cJSON_Delete(json);
+        Arena_delete(arena);
         Storage_freeRunMetadata(meta);
         return NULL;
     }
@@ -199,7 +361,7 @@ RunMetadata* Storage_readMetadata(const char* run_dir) {
     meta->cpu_count = getJsonInt(json, "cpu_count", 0);
     meta->gpu_count = getJsonInt(json, "gpu_count", 0);
 
-    cJSON_Delete(json);
+    Arena_delete(arena);
     return meta;
 }
 
@@ -221,20 +383,14 @@ void Storage_freeRunMetadata(RunMetadata* meta) {
 
 // Reads and returns the summary information for a specific run
 RunSummary* Storage_readSummary(const char* run_dir) {
-    char* path = buildPath(run_dir, "summary.json");
-    if (!path) return NULL;
-    
-    char* content = readFileToString(path);
-    free(path);
-    if (!content) return NULL;
-
-    cJSON* json = cJSON_Parse(content);
-    free(content);
+    // Rewritten on every logged step, so this is the file re-read most often
+    Arena* arena;
+    cJSON* json = parseJsonFile(run_dir, "summary.json", &arena);
     if (!json) return NULL;
 
     RunSummary* sum = calloc(1, sizeof(RunSummary));
     if (!sum) {
-        cJSON_Delete(json);
+        Arena_delete(arena);
         return NULL;
     }
     
@@ -243,16 +399,17 @@ RunSummary* Storage_readSummary(const char* run_dir) {
     
     // Check if required allocation failed
     if (!sum->status) {
-        cJSON_Delete(json);
+        Arena_delete(arena);
         free(sum);
         return NULL;
     }
     
     sum->runtime = getJsonDouble(json, "_runtime", 0.0);
     sum->timestamp = getJsonDouble(json, "_timestamp", 0.0);
-    sum->step = getJsonInt(json, "_step", 0);
+    sum->step = getJsonInt64(json, "_step", 0);
     sum->epoch = getJsonInt(json, "epoch", 0);
     sum->json = json;  // Keep JSON for additional fields
+    sum->arena = arena;
 
     return sum;
 }
@@ -261,63 +418,1142 @@ RunSummary* Storage_readSummary(const char* run_dir) {
 void Storage_freeRunSummary(RunSummary* summary) {
     if (!summary) return;
     free(summary->status);
-    if (summary->json) cJSON_Delete(summary->json);
+    Arena_delete(summary->arena);
     free(summary);
 }
 
-// Opens the metrics file for sequential reading and returns an opaque handle
-void* Storage_openMetrics(const char* run_dir) {
-    char* path = buildPath(run_dir, "metrics.jsonl");
-    if (!path) return NULL;
-    
-    FILE* f = fopen(path, "r");
+// Extracts a finite number from JSON object, or 'def' if it is missing or null
+static double getJsonNumber(cJSON* root, const char* key, double def) {
+    cJSON* item = cJSON_GetObjectItem(root, key);
+    if (item && cJSON_IsNumber(item) && isfinite(item->valuedouble)) { return item->valuedouble; }
+    return def;
+}
+
+// Checks one stream entry of keys.json against the run: it has to name the file the stream
+// is read from (binary wins, as in Storage_openMetricsStream), and stats for more bytes
+// than that file holds belong to some earlier file. Adds the bytes covered to '*covered'
+static bool keyManifestStreamValid(const char* run_dir, cJSON* item, int64_t* covered) {
+    char* name = getJsonString(item, "name", "");
+    char* file = getJsonString(item, "file", NULL);
+    int64_t offset = getJsonInt64(item, "covered_offset", -1);
+
+    bool valid = name && file && offset >= 0 && (*name == '\0' || isStreamName(name));
+    if (valid) {
+        char* binary_path = buildStreamPath(run_dir, name, ".expb");
+        char* jsonl_path = buildStreamPath(run_dir, name, ".jsonl");
+        bool binary = binary_path && access(binary_path, F_OK) == 0;
+        const char* path = binary ? binary_path : jsonl_path;
+        const char* base = path ? strrchr(path, '/') + 1 : NULL;
+
+        // A stream nothing was logged to yet may not have its file
+        struct stat st;
+        valid = base && strcmp(base, file) == 0 &&
+                (offset == 0 || (stat(path, &st) == 0 && offset <= (int64_t)st.st_size));
+        free(binary_path);
+        free(jsonl_path);
+    }
+    if (valid) *covered += offset;
+    free(name);
+    free(file);
+    return valid;
+}
+
+// Reads the run's keys.json. Returns NULL if it is missing or malformed, or if it does not
+// describe a prefix of each of the run's current metrics streams
+KeyManifest* Storage_readKeyManifest(const char* run_dir) {
+    Arena* arena;
+    cJSON* json = parseJsonFile(run_dir, KEYS_MANIFEST_FILENAME, &arena);
+    if (!json) return NULL;
+
+    cJSON* streams = cJSON_GetObjectItem(json, "streams");
+    bool valid = getJsonInt(json, "version", 0) == KEYS_MANIFEST_VERSION && cJSON_IsArray(streams);
+    int64_t covered = 0;
+    cJSON* stream;
+    cJSON_ArrayForEach(stream, streams) {
+        if (valid) valid = keyManifestStreamValid(run_dir, stream, &covered);
+    }
+
+    cJSON* keys = cJSON_GetObjectItem(json, "keys");
+    KeyManifest* manifest = valid && cJSON_IsArray(keys) ? calloc(1, sizeof(KeyManifest)) : NULL;
+    int size = manifest ? cJSON_GetArraySize(keys) : 0;
+    if (manifest && size > 0) {
+        manifest->keys = calloc(size, sizeof(KeyManifestEntry));
+        if (!manifest->keys) {
+            free(manifest);
+            manifest = NULL;
+        }
+    }
+    if (!manifest) {
+        Arena_delete(arena);
+        return NULL;
+    }
+
+    manifest->covered_offset = (off_t)covered;
+    cJSON* item;
+    cJSON_ArrayForEach(item, keys) {
+        char* name = getJsonString(item, "name", NULL);
+        if (!name) continue;
+
+        KeyManifestEntry* e = &manifest->keys[manifest->count++];
+        e->name = name;
+        e->first_step = getJsonInt64(item, "first_step", -1);
+        e->last_step = getJsonInt64(item, "last_step", -1);
+        e->count = getJsonInt64(item, "count", 0);
+        e->min_value = getJsonNumber(item, "min", INFINITY);
+        e->max_value = getJsonNumber(item, "max", -INFINITY);
+        e->last_value = getJsonNumber(item, "last", NAN);
+        e->first_offset = (off_t)getJsonInt64(item, "first_offset", 0);
+    }
+    Arena_delete(arena);
+    return manifest;
+}
+
+// Frees memory allocated for a KeyManifest structure
+void Storage_freeKeyManifest(KeyManifest* manifest) {
+    if (!manifest) return;
+    for (int i = 0; i < manifest->count; i++) free(manifest->keys[i].name);
+    free(manifest->keys);
+    free(manifest);
+}
+
+// Reads the run's streams.json. Names that could not be a stream are left out. Returns NULL
+// if it is missing or malformed; a run without one logs everything to the main file
+StreamList* Storage_readStreamList(const char* run_dir) {
+    Arena* arena;
+    cJSON* json = parseJsonFile(run_dir, STREAMS_MANIFEST_FILENAME, &arena);
+    if (!json) return NULL;
+
+    cJSON* names = cJSON_GetObjectItem(json, "streams");
+    StreamList* streams = NULL;
+    if (getJsonInt(json, "version", 0) == STREAMS_MANIFEST_VERSION && cJSON_IsArray(names)) {
+        streams = calloc(1, sizeof(StreamList));
+    }
+    int size = streams ? cJSON_GetArraySize(names) : 0;
+    if (streams && size > 0) {
+        streams->names = calloc(size, sizeof(char*));
+        if (!streams->names) {
+            free(streams);
+            streams = NULL;
+        }
+    }
+    if (!streams) {
+        Arena_delete(arena);
+        return NULL;
+    }
+
+    cJSON* item;
+    cJSON_ArrayForEach(item, names) {
+        if (!cJSON_IsString(item) || !isStreamName(item->valuestring)) continue;
+        char* name = strdup(item->valuestring);
+        if (name) streams->names[streams->count++] = name;
+    }
+    Arena_delete(arena);
+    return streams;
+}
+
+// Frees memory allocated for a StreamList structure
+void Storage_freeStreamList(StreamList* streams) {
+    if (!streams) return;
+    for (int i = 0; i < streams->count; i++) free(streams->names[i]);
+    free(streams->names);
+    free(streams);
+}
+
+// Takes the fingerprint of 'name' in 'run_dir'; a missing file is simply not present
+static FileFingerprint fingerprintFile(const char* run_dir, const char* name) {
+    FileFingerprint print;
+    memset(&print, 0, sizeof(print));
+
+    char* path = buildPath(run_dir, name);
+    struct stat st;
+    if (path && stat(path, &st) == 0) {
+        print.present = true;
+        print.dev = (uint64_t)st.st_dev;
+        print.ino = (uint64_t)st.st_ino;
+        print.size = (int64_t)st.st_size;
+        print.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
     free(path);
-    
-    if (!f) return NULL;
+    return print;
+}
 
-    MetricsHandle* h = malloc(sizeof(MetricsHandle));
-    if (!h) {
-        fclose(f);
+// Returns true if two fingerprints describe the same version of a file
+bool Storage_sameFingerprint(const FileFingerprint* a, const FileFingerprint* b) {
+    if (a->present != b->present) return false;
+    return !a->present || (a->dev == b->dev && a->ino == b->ino && a->size == b->size && a->mtime_ns == b->mtime_ns);
+}
+
+// Creates an empty cache of the run's JSON files; nothing is read until the first refresh
+RunFiles* Storage_openRunFiles(const char* run_dir) {
+    if (!run_dir) return NULL;
+    RunFiles* files = calloc(1, sizeof(RunFiles));
+    if (!files) return NULL;
+
+    files->run_dir = strdup(run_dir);
+    if (!files->run_dir) {
+        free(files);
         return NULL;
     }
-    
+    return files;
+}
+
+// Re-reads whichever of config.json, metadata.json, summary.json and streams.json changed on
+// disk since the last call. Returns true if any cached object was replaced.
+// A file that fails to parse (e.g. caught mid-write) keeps its previous object and
+// fingerprint, so it is retried on the next call
+bool Storage_refreshRunFiles(RunFiles* files) {
+    if (!files) return false;
+    bool changed = false;
+
+    FileFingerprint print = fingerprintFile(files->run_dir, "config.json");
+    if (!Storage_sameFingerprint(&print, &files->config_print)) {
+        RunConfig* config = print.present ? Storage_readConfig(files->run_dir) : NULL;
+        if (config || !print.present) {
+            Storage_freeRunConfig(files->config);
+            files->config = config;
+            files->config_print = print;
+            changed = true;
+        }
+    }
+
+    print = fingerprintFile(files->run_dir, "metadata.json");
+    if (!Storage_sameFingerprint(&print, &files->meta_print)) {
+        RunMetadata* meta = print.present ? Storage_readMetadata(files->run_dir) : NULL;
+        if (meta || !print.present) {
+            Storage_freeRunMetadata(files->meta);
+            files->meta = meta;
+            files->meta_print = print;
+            changed = true;
+        }
+    }
+
+    print = fingerprintFile(files->run_dir, "summary.json");
+    if (!Storage_sameFingerprint(&print, &files->summary_print)) {
+        RunSummary* summary = print.present ? Storage_readSummary(files->run_dir) : NULL;
+        if (summary || !print.present) {
+            Storage_freeRunSummary(files->summary);
+            files->summary = summary;
+            files->summary_print = print;
+            changed = true;
+        }
+    }
+
+    print = fingerprintFile(files->run_dir, STREAMS_MANIFEST_FILENAME);
+    if (!Storage_sameFingerprint(&print, &files->streams_print)) {
+        StreamList* streams = print.present ? Storage_readStreamList(files->run_dir) : NULL;
+        if (streams || !print.present) {
+            Storage_freeStreamList(files->streams);
+            files->streams = streams;
+            files->streams_print = print;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Frees the cache and every object it holds
+void Storage_closeRunFiles(RunFiles* files) {
+    if (!files) return;
+    Storage_freeRunConfig(files->config);
+    Storage_freeRunMetadata(files->meta);
+    Storage_freeRunSummary(files->summary);
+    Storage_freeStreamList(files->streams);
+    free(files->run_dir);
+    free(files);
+}
+
+// Starts watching the run directory for changes to the files the TUI reads. Returns a
+// non-blocking descriptor to poll, or -1 if change notification is unavailable here
+int Storage_watchRun(const char* run_dir) {
+#ifdef __linux__
+    if (!run_dir) return -1;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return -1;
+
+    // The writer appends and rewrites in place, but replacements (rename over, delete and
+    // recreate) have to be noticed as well
+    uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                    IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(fd, run_dir, mask) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void)run_dir;
+    return -1;
+#endif
+}
+
+#ifdef __linux__
+// Returns true if 'name' ends with 'suffix'
+static bool hasSuffix(const char* name, const char* suffix) {
+    size_t len = strlen(name), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+// Returns true for the run files whose changes the TUI has to pick up, namespace streams
+// (metrics.<name>.jsonl or .expb) included
+static bool isRunFile(const char* name) {
+    static const char* const names[] = {
+        METRICS_FILENAME, BINARY_METRICS_FILENAME, "summary.json", "config.json", "metadata.json",
+        STREAMS_MANIFEST_FILENAME, NULL
+    };
+    for (int i = 0; names[i]; i++) {
+        if (strcmp(name, names[i]) == 0) return true;
+    }
+    return strncmp(name, "metrics.", 8) == 0 && (hasSuffix(name, ".jsonl") || hasSuffix(name, ".expb"));
+}
+#endif
+
+// Consumes every pending notification on a descriptor from Storage_watchRun. Returns true if
+// any concerns a run file; the TUI's own log, sidecar and index writes are ignored
+bool Storage_drainRunWatch(int fd) {
+#ifdef __linux__
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool relevant = false;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n;) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            // A lost queue or a vanished directory could hide anything: treat it as a change
+            if (ev->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)) relevant = true;
+            if (ev->len > 0 && isRunFile(ev->name)) relevant = true;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return relevant;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+// Stops watching and closes the descriptor
+void Storage_unwatchRun(int fd) {
+    if (fd >= 0) close(fd);
+}
+
+// Opens the metrics file and records its identity so replacement can be detected later
+static bool openMetricsFile(MetricsHandle* h) {
+    FILE* f = fopen(h->path, "r");
+    if (!f) return false;
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) {
+        fclose(f);
+        return false;
+    }
+
     h->file = f;
-    h->line_buffer = NULL;
-    h->buffer_size = 0;
+    h->dev = st.st_dev;
+    h->ino = st.st_ino;
+    h->committed = 0;
+    return true;
+}
+
+// Resizes the mapping to cover the first 'size' bytes of the file. The writer only ever
+// appends, so on Linux the mapping is extended over the new bytes rather than mapped afresh.
+// It shrinks along with a file that got shorter, so no read lands past its end. On failure
+// the old mapping is kept
+static bool remapMetricsFile(MetricsHandle* h, off_t size) {
+    // A zero-length mapping is invalid; an empty file simply has nothing to hand out yet
+    if (size <= 0 || (uintmax_t)size > SIZE_MAX) {
+        if (h->map) munmap((void*)h->map, h->map_size);
+        h->map = NULL;
+        h->map_size = 0;
+        return size <= 0;
+    }
+    if ((size_t)size == h->map_size) return true;
+
+    void* map = MAP_FAILED;
+#ifdef __linux__
+    if (h->map) map = mremap((void*)h->map, h->map_size, (size_t)size, MREMAP_MAYMOVE);
+#endif
+    if (map == MAP_FAILED) {
+        map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(h->file), 0);
+        if (map == MAP_FAILED) return false;
+        if (h->map) munmap((void*)h->map, h->map_size);
+    }
+
+    posix_madvise(map, (size_t)size, POSIX_MADV_SEQUENTIAL);
+    h->map = map;
+    h->map_size = (size_t)size;
+    return true;
+}
+
+// Maps the freshly opened file, degrading the handle to stdio reads if mapping fails
+static void mapMetricsFile(MetricsHandle* h) {
+    if (h->mode != METRICS_READ_MMAP) return;
+
+    struct stat st;
+    if (fstat(fileno(h->file), &st) != 0 || !remapMetricsFile(h, st.st_size)) {
+        h->mode = METRICS_READ_STDIO;
+    }
+}
+
+// Decodes little-endian integers and doubles from unaligned bytes
+static uint16_t readU16LE(const unsigned char* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32LE(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static double readF64LE(const unsigned char* p) {
+    uint64_t bits = (uint64_t)readU32LE(p) | ((uint64_t)readU32LE(p + 4) << 32);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Forgets the binary key dictionary, e.g. when the file is replaced
+static void resetBinaryKeys(MetricsHandle* h) {
+    for (uint32_t i = 0; i < h->key_count; i++) free(h->key_names[i]);
+    h->key_count = 0;
+}
+
+// Forgets the step index, e.g. when the file is replaced. The copy on disk describes the old
+// file, so it is not reloaded
+static void resetStepIndex(MetricsHandle* h) {
+    h->index_loaded = true;
+    h->index_count = 0;
+    h->index_end = 0;
+    h->index_saved = 0;
+    h->index_max_step = -1;
+}
+
+// Returns 'size' bytes at 'offset' as a pointer into the mapping or the handle's buffer,
+// or NULL if the writer has not appended that far yet
+static const unsigned char* peekBinary(MetricsHandle* h, off_t offset, size_t size) {
+    if (h->mode == METRICS_READ_MMAP) {
+        if ((size_t)offset > h->map_size || size > h->map_size - (size_t)offset) return NULL;
+        return (const unsigned char*)h->map + offset;
+    }
+
+    if (size > h->buffer_size) {
+        char* buffer = realloc(h->line_buffer, size);
+        if (!buffer) return NULL;
+        h->line_buffer = buffer;
+        h->buffer_size = size;
+    }
+    clearerr(h->file);
+    if (fseeko(h->file, offset, SEEK_SET) != 0 || fread(h->line_buffer, 1, size, h->file) != size) return NULL;
+    return (const unsigned char*)h->line_buffer;
+}
+
+// Consumes the next committed binary record. A record whose bytes or commit marker are not
+// all on disk yet is left for the next sync, as is anything after a corrupt record
+static bool nextBinaryRecord(MetricsHandle* h, unsigned* type, const unsigned char** payload, uint32_t* len) {
+    if (h->committed == 0) {
+        const unsigned char* hdr = peekBinary(h, 0, BINARY_HEADER_SIZE);
+        if (!hdr || memcmp(hdr, BINARY_MAGIC, 4) != 0 || readU32LE(hdr + 4) != BINARY_VERSION) return false;
+        h->committed = BINARY_HEADER_SIZE;
+    }
+
+    const unsigned char* p = peekBinary(h, h->committed, BINARY_RECORD_HEADER_SIZE);
+    if (!p) return false;
+    uint32_t size = readU32LE(p + 4);
+    if (size > BINARY_MAX_PAYLOAD) return false;
+
+    size_t total = BINARY_RECORD_HEADER_SIZE + (size_t)size + BINARY_COMMIT_SIZE;
+    p = peekBinary(h, h->committed, total);
+    if (!p || readU32LE(p + BINARY_RECORD_HEADER_SIZE + size) != BINARY_COMMIT_MARKER) return false;
+
+    *type = p[0];
+    *payload = p + BINARY_RECORD_HEADER_SIZE;
+    *len = size;
+    h->committed += (off_t)total;
+    return true;
+}
+
+// Adds the key definitions of a 'K' record to the handle's dictionary.
+// The writer hands out ids densely, so an id past the end of the dictionary is corrupt
+static void loadBinaryKeys(MetricsHandle* h, const unsigned char* p, uint32_t len) {
+    const unsigned char* end = p + len;
+    while (end - p >= 6) {
+        uint32_t id = readU32LE(p);
+        size_t name_len = readU16LE(p + 4);
+        p += 6;
+        if ((size_t)(end - p) < name_len || id > h->key_count) return;
+
+        if (id >= h->key_capacity) {
+            uint32_t new_capacity = h->key_capacity ? h->key_capacity * 2 : 64;
+            char** names = realloc(h->key_names, new_capacity * sizeof(char*));
+            if (!names) return;
+            h->key_names = names;
+            size_t* lens = realloc(h->key_lens, new_capacity * sizeof(size_t));
+            if (!lens) return;
+            h->key_lens = lens;
+            h->key_capacity = new_capacity;
+        }
+
+        char* name = malloc(name_len + 1);
+        if (!name) return;
+        memcpy(name, p, name_len);
+        name[name_len] = '\0';
+        if (id < h->key_count) {
+            free(h->key_names[id]);
+        } else {
+            h->key_count = id + 1;
+        }
+        h->key_names[id] = name;
+        h->key_lens[id] = name_len;
+        p += name_len;
+    }
+}
+
+// Fills the record from an 'R' record's (key id, value) pairs. Fields whose key was never
+// defined are dropped
+static void decodeBinaryRow(MetricsHandle* h, const unsigned char* p, uint32_t len, MetricRecord* record) {
+    MetricRecord_clear(record);
+    for (uint32_t i = 0; len - i >= BINARY_FIELD_SIZE; i += BINARY_FIELD_SIZE) {
+        uint32_t id = readU32LE(p + i);
+        if (id >= h->key_count) continue;
+        if (!MetricRecord_addField(record, h->key_names[id], h->key_lens[id], readF64LE(p + i + 4))) return;
+    }
+}
+
+// Opens the metrics file for incremental reading and returns an opaque handle. Reads the
+// binary metrics.expb if the run has one, else metrics.jsonl.
+// METRICS_READ_MMAP falls back to stdio if the file cannot be mapped
+void* Storage_openMetrics(const char* run_dir, MetricsReadMode mode) {
+    return Storage_openMetricsStream(run_dir, NULL, mode);
+}
+
+// Like Storage_openMetrics, for the namespace stream 'stream' (metrics.<stream>.expb or
+// .jsonl). The handle's step index and sidecar are the stream's own. NULL opens the main file
+void* Storage_openMetricsStream(const char* run_dir, const char* stream, MetricsReadMode mode) {
+    if (stream && !isStreamName(stream)) return NULL;
+    MetricsHandle* h = calloc(1, sizeof(MetricsHandle));
+    if (!h) return NULL;
+
+    // A run logged in the binary format has metrics.expb; everything else is JSONL
+    h->path = buildStreamPath(run_dir, stream, ".expb");
+    if (h->path && access(h->path, F_OK) == 0) {
+        h->binary = true;
+    } else {
+        free(h->path);
+        h->path = buildStreamPath(run_dir, stream, ".jsonl");
+    }
+    h->sidecar_path = buildStreamPath(run_dir, stream, ".expc");
+    h->index_path = buildStreamPath(run_dir, stream, ".sidx");
+    if (!h->path || !h->sidecar_path || !h->index_path || !openMetricsFile(h)) {
+        free(h->path);
+        free(h->sidecar_path);
+        free(h->index_path);
+        free(h);
+        return NULL;
+    }
+
+    h->index_max_step = -1;
+    h->mode = mode;
+    mapMetricsFile(h);
     return h;
 }
 
-// Reads the next metric entry from an open metrics handle, or NULL if no more entries
-MetricEntry* Storage_readNextMetric(void* handle) {
+// Re-checks the metrics file behind an open handle. Returns true if the file was truncated
+// or replaced, in which case reading restarts at byte 0 and all previous entries are stale
+bool Storage_syncMetrics(void* handle) {
     MetricsHandle* h = (MetricsHandle*)handle;
-    if (!h) return NULL;
+    if (!h) return false;
+
+    struct stat st;
+    if (stat(h->path, &st) != 0) return false;  // Missing for now; keep what we have
+
+    bool replaced = (st.st_dev != h->dev || st.st_ino != h->ino);
+    bool truncated = (st.st_size < h->committed);
+    if (!replaced && !truncated) {
+        // A failed reopen clears the identity, so this only guards against a bare handle
+        if (!h->file) return false;
+        if (h->mode == METRICS_READ_MMAP) {
+            // Follow the file's size: grow over newly appended bytes, and drop pages past
+            // an end that moved back without reaching what was already read
+            if ((size_t)st.st_size != h->map_size && !remapMetricsFile(h, st.st_size)) {
+                return false;
+            }
+        } else {
+            // Clear a sticky EOF so getline sees bytes appended since the last read
+            clearerr(h->file);
+        }
+        return false;
+    }
+
+    Storage_reopenMetrics(h);
+    return true;
+}
+
+// Drops everything read from a metrics handle and reopens its file from byte 0, as a sync
+// that found it replaced does. Used after a guarded read faulted
+void Storage_reopenMetrics(void* handle) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h) return;
+
+    // Unmap before closing: touching pages past a truncated EOF would raise SIGBUS
+    remapMetricsFile(h, 0);
+    resetBinaryKeys(h);
+    resetStepIndex(h);
+    if (h->file) fclose(h->file);
+    h->file = NULL;
+    if (openMetricsFile(h)) {
+        mapMetricsFile(h);
+    } else {
+        // Forget the old identity: a file recreated on the same inode must still be reopened
+        h->committed = 0;
+        h->dev = 0;
+        h->ino = 0;
+    }
+}
+
+static _Thread_local MappingGuard* current_guard;   // Innermost guard of the calling thread
+static pthread_once_t sigbus_once = PTHREAD_ONCE_INIT;
+static struct sigaction previous_sigbus;
+
+// SIGBUS handler: unwinds to the faulting thread's innermost guard. A fault no guard covers
+// goes back to the previous disposition; returning re-runs the faulting read, which takes it
+static void onSigbus(int sig) {
+    MappingGuard* guard = current_guard;
+    if (guard) {
+        current_guard = guard->outer;
+        siglongjmp(guard->env, 1);
+    }
+    sigaction(sig, &previous_sigbus, NULL);
+}
+
+// Installs onSigbus, once per process
+static void installSigbusHandler(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSigbus;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGBUS, &sa, &previous_sigbus);
+}
+
+// Makes 'guard' the calling thread's innermost mapping guard; see MappingGuard
+void Storage_armGuard(MappingGuard* guard) {
+    pthread_once(&sigbus_once, installSigbusHandler);
+    guard->outer = current_guard;
+    current_guard = guard;
+}
+
+// Takes 'guard', the calling thread's innermost mapping guard, off again
+void Storage_disarmGuard(MappingGuard* guard) {
+    current_guard = guard->outer;
+}
+
+// Returns the byte offset just past the last complete line or record read from the handle
+off_t Storage_getMetricsOffset(void* handle) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    return h ? h->committed : 0;
+}
+
+// Hands out the next complete line (without its newline) as a slice into the handle's buffer
+// or mapping. The slice stays valid until the next read or sync on the same handle.
+// JSONL only; binary handles have no lines
+bool Storage_readNextLine(void* handle, const char** line, size_t* len) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || !h->file || h->binary) return false;
+
+    if (h->mode == METRICS_READ_MMAP) {
+        if ((size_t)h->committed >= h->map_size) return false;
+
+        const char* start = h->map + h->committed;
+        size_t remaining = h->map_size - (size_t)h->committed;
+
+        // No newline yet means the writer is mid-append; leave the tail for the next sync
+        const char* newline = memchr(start, '\n', remaining);
+        if (!newline) return false;
+
+        *line = start;
+        *len = (size_t)(newline - start);
+        h->committed += (off_t)(*len + 1);
+        return true;
+    }
 
     // Read next line from file (getline allocates/reallocs buffer automatically)
     ssize_t read = getline(&h->line_buffer, &h->buffer_size, h->file);
-    if (read < 0) return NULL;  // EOF or error
+    if (read < 0) return false;  // EOF or error
+
+    // The writer may be mid-append: rewind and retry this line on the next sync
+    if (h->line_buffer[read - 1] != '\n') {
+        fseeko(h->file, h->committed, SEEK_SET);
+        return false;
+    }
+    h->committed += read;
+
+    *line = h->line_buffer;
+    *len = (size_t)read - 1;
+    return true;
+}
+
+// Returns every complete line not read yet as one slice of the mapping, without consuming
+// them; seek past the slice once it has been parsed. Only JSONL handles in
+// METRICS_READ_MMAP mode support this. The slice stays valid until the next sync, and is
+// read under a MappingGuard since the file may still shrink underneath it
+bool Storage_peekMetrics(void* handle, const char** data, size_t* len) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || !h->file || h->binary || h->mode != METRICS_READ_MMAP) return false;
+    if ((size_t)h->committed >= h->map_size) return false;
+
+    // Stop after the last newline; a trailing partial line is still being written
+    const char* start = h->map + h->committed;
+    size_t end = h->map_size - (size_t)h->committed;
+    while (end > 0 && start[end - 1] != '\n') end--;
+    if (end == 0) return false;
+
+    *data = start;
+    *len = end;
+    return true;
+}
+
+// Parses the next complete metrics line into a reusable record without building a cJSON
+// tree for flat rows. Malformed lines are skipped. Returns false when no more lines are ready.
+// For binary handles, decodes the next row record instead
+bool Storage_readNextRecord(void* handle, MetricRecord* record) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    const char* line;
+    size_t len;
+
+    if (h && h->binary) {
+        unsigned type;
+        const unsigned char* payload;
+        uint32_t size;
+        while (h->file && nextBinaryRecord(h, &type, &payload, &size)) {
+            if (type == BINARY_RECORD_KEYS) {
+                loadBinaryKeys(h, payload, size);
+            } else if (type == BINARY_RECORD_ROW) {
+                decodeBinaryRow(h, payload, size, record);
+                return true;
+            }
+            // Unknown record types are skipped so newer writers stay readable
+        }
+        return false;
+    }
+
+    while (Storage_readNextLine(handle, &line, &len)) {
+        if (MetricsParser_parseLine(line, len, record)) return true;
+    }
+    return false;
+}
+
+// Reads the next complete metric entry from an open metrics handle, or NULL if no more entries.
+// A partially written trailing line is left unread until the writer finishes it
+MetricEntry* Storage_readNextMetric(void* handle) {
+    const char* line;
+    size_t len;
+
+    while (Storage_readNextLine(handle, &line, &len)) {
+        // Parse straight from the slice; skip malformed lines instead of stopping the whole read
+        cJSON* json = cJSON_ParseWithLength(line, len);
+        if (!json) continue;
+
+        MetricEntry* entry = calloc(1, sizeof(MetricEntry));
+        if (!entry) {
+            cJSON_Delete(json);
+            return NULL;
+        }
+
+        entry->json = json;
+        entry->step = getJsonInt64(json, "_step", -1);
+        entry->timestamp = getJsonDouble(json, "_timestamp", 0.0);
+        return entry;
+    }
+    return NULL;
+}
+
+// Moves the read position of a metrics handle to a line boundary previously reported by
+// Storage_getMetricsOffset (e.g. the end of what a sidecar cache already covers).
+// A binary handle that fails to seek is left back at the start of the file
+bool Storage_seekMetrics(void* handle, off_t offset) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || !h->file || offset < 0) return false;
+
+    if (h->binary) {
+        // Rows refer to keys by id, so replay the dictionary records that precede 'offset'
+        resetBinaryKeys(h);
+        h->committed = 0;
 
-    cJSON* json = cJSON_Parse(h->line_buffer);
-    if (!json) return NULL;  // Invalid JSON line
+        unsigned type;
+        const unsigned char* payload;
+        uint32_t size;
+        while (h->committed < offset && nextBinaryRecord(h, &type, &payload, &size)) {
+            if (type == BINARY_RECORD_KEYS) loadBinaryKeys(h, payload, size);
+        }
+        if (h->committed == offset) return true;
 
-    MetricEntry* entry = calloc(1, sizeof(MetricEntry));
-    if (!entry) {
-        cJSON_Delete(json);
+        resetBinaryKeys(h);
+        h->committed = 0;
+        return false;
+    }
+
+    if (h->mode == METRICS_READ_MMAP) {
+        if ((size_t)offset > h->map_size) return false;
+    } else if (fseeko(h->file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    h->committed = offset;
+    return true;
+}
+
+// Returns true if a cache built from the first 'size' bytes of a metrics file with the given
+// identity and mtime still describes a prefix of 'source'. The writer only appends, so it
+// stays valid while the source is the same file and has not shrunk. Same size with a new
+// mtime means it was rewritten in place
+static bool sourceUnchanged(const struct stat* source, uint64_t dev, uint64_t ino, int64_t size,
+                            int64_t mtime_sec, int64_t mtime_nsec) {
+    if (dev != (uint64_t)source->st_dev || ino != (uint64_t)source->st_ino || source->st_size < size) {
+        return false;
+    }
+    return source->st_size != size ||
+           (mtime_sec == (int64_t)source->st_mtim.tv_sec && mtime_nsec == (int64_t)source->st_mtim.tv_nsec);
+}
+
+// Loads metrics.sidx into the handle if it still describes a prefix of the metrics file
+static void loadStepIndex(MetricsHandle* h) {
+    h->index_loaded = true;
+
+    FILE* f = fopen(h->index_path, "rb");
+    if (!f) return;
+
+    StepIndexHeader hdr;
+    struct stat source;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && fstat(fileno(h->file), &source) == 0 &&
+              memcmp(hdr.magic, STEP_INDEX_MAGIC, 4) == 0 && hdr.version == STEP_INDEX_VERSION &&
+              hdr.byte_order == SIDECAR_BYTE_ORDER && hdr.interval == STEP_INDEX_INTERVAL &&
+              sourceUnchanged(&source, hdr.source_dev, hdr.source_ino, hdr.source_size,
+                              hdr.source_mtime_sec, hdr.source_mtime_nsec) &&
+              hdr.entry_count > 0 && hdr.entry_count <= (uint64_t)hdr.source_size;
+
+    StepIndexEntry* entries = ok ? malloc(hdr.entry_count * sizeof(StepIndexEntry)) : NULL;
+    ok = entries && fread(entries, sizeof(StepIndexEntry), hdr.entry_count, f) == hdr.entry_count;
+    fclose(f);
+    for (uint64_t i = 0; ok && i < hdr.entry_count; i++) {
+        ok = entries[i].offset <= hdr.source_size && (i == 0 || entries[i].offset > entries[i - 1].offset);
+    }
+    if (!ok) {
+        free(entries);
+        return;
+    }
+
+    free(h->index);
+    h->index = entries;
+    h->index_count = h->index_capacity = (size_t)hdr.entry_count;
+    h->index_end = h->index_saved = (off_t)hdr.source_size;
+    h->index_max_step = hdr.max_step;
+}
+
+// Returns the "_step" of a JSONL row, or -1 if it has none. Only the key is looked for,
+// so this is far cheaper than parsing the row
+static int64_t findLineStep(const char* line, size_t len) {
+    const char* end = line + len;
+    const char* p = line;
+    while ((p = memchr(p, '"', (size_t)(end - p))) != NULL) {
+        if (end - p >= 7 && memcmp(p, "\"_step\"", 7) == 0) {
+            p += 7;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (p == end || *p != ':') return -1;
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+            double step;
+            return FastFloat_parse(p, end, &step) ? MetricsParser_toStep(step) : -1;
+        }
+        p++;
+    }
+    return -1;
+}
+
+// Records one line in the index, starting a new entry once STEP_INDEX_INTERVAL bytes have
+// passed since the previous one
+static void indexLine(MetricsHandle* h, off_t start, int64_t step) {
+    if (h->index_count == 0 || start - h->index[h->index_count - 1].offset >= STEP_INDEX_INTERVAL) {
+        if (h->index_count >= h->index_capacity) {
+            size_t new_capacity = h->index_capacity ? h->index_capacity * 2 : 256;
+            StepIndexEntry* entries = realloc(h->index, new_capacity * sizeof(StepIndexEntry));
+            if (!entries) return;
+            h->index = entries;
+            h->index_capacity = new_capacity;
+        }
+        h->index[h->index_count].offset = start;
+        h->index[h->index_count].max_step = h->index_max_step;
+        h->index_count++;
+    }
+    if (step > h->index_max_step) h->index_max_step = step;
+}
+
+// Extends the sparse _step index over every line consumed from the handle so far, as long
+// as the index already reaches 'from', where the caller's reads began: the index runs
+// unbroken from byte 0, and lines nobody read are not paged in just to index them.
+// Only JSONL handles in METRICS_READ_MMAP mode are indexed
+void Storage_updateStepIndex(void* handle, off_t from) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || !h->file || h->binary || h->mode != METRICS_READ_MMAP) return;
+    if (!h->index_loaded) loadStepIndex(h);
+    if (h->index_end < from) return;
+
+    while (h->index_end < h->committed && (size_t)h->committed <= h->map_size) {
+        const char* line = h->map + h->index_end;
+        const char* newline = memchr(line, '\n', (size_t)(h->committed - h->index_end));
+        if (!newline) break;
+
+        size_t len = (size_t)(newline - line);
+        indexLine(h, h->index_end, findLineStep(line, len));
+        h->index_end += (off_t)(len + 1);
+    }
+}
+
+// Returns an offset to read from to see every row whose _step is at least 'step': all rows
+// before it have lower steps. Without an index this is 0, the start of the file
+off_t Storage_findStep(void* handle, int64_t step) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || h->binary) return 0;
+    if (!h->index_loaded) loadStepIndex(h);
+    if (h->index_count == 0) return 0;
+
+    // Everything indexed is below 'step', so only the unindexed tail needs reading
+    if (step > h->index_max_step) return h->index_end;
+
+    // Entries' max_step never decreases; find the last one still below 'step'
+    size_t lo = 0, hi = h->index_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (h->index[mid].max_step < step) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return h->index[lo].max_step < step ? (off_t)h->index[lo].offset : 0;
+}
+
+// Atomically writes metrics.sidx for everything indexed so far. Does nothing if the index
+// on disk is already current. Returns true if written
+bool Storage_saveStepIndex(void* handle) {
+    MetricsHandle* h = (MetricsHandle*)handle;
+    if (!h || !h->file || h->index_count == 0 || h->index_end == h->index_saved) return false;
+
+    struct stat source;
+    if (fstat(fileno(h->file), &source) != 0) return false;
+
+    StepIndexHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, STEP_INDEX_MAGIC, 4);
+    hdr.version = STEP_INDEX_VERSION;
+    hdr.byte_order = SIDECAR_BYTE_ORDER;
+    hdr.interval = STEP_INDEX_INTERVAL;
+    hdr.source_dev = (uint64_t)source.st_dev;
+    hdr.source_ino = (uint64_t)source.st_ino;
+    hdr.source_size = (int64_t)h->index_end;
+    hdr.source_mtime_sec = (int64_t)source.st_mtim.tv_sec;
+    hdr.source_mtime_nsec = (int64_t)source.st_mtim.tv_nsec;
+    hdr.max_step = h->index_max_step;
+    hdr.entry_count = h->index_count;
+
+    size_t tmp_len = strlen(h->index_path) + 5;
+    char* tmp_path = malloc(tmp_len);
+    if (!tmp_path) return false;
+    snprintf(tmp_path, tmp_len, "%s.tmp", h->index_path);
+
+    FILE* f = fopen(tmp_path, "wb");
+    bool ok = f != NULL && fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(h->index, sizeof(StepIndexEntry), h->index_count, f) == h->index_count;
+    if (f && fclose(f) != 0) ok = false;
+    if (ok) ok = rename(tmp_path, h->index_path) == 0;
+    if (!ok) unlink(tmp_path);
+    free(tmp_path);
+
+    if (ok) h->index_saved = h->index_end;
+    return ok;
+}
+
+// Returns true if [offset, offset + size) lies inside a mapping of map_size bytes
+static bool sidecarRangeValid(uint64_t offset, uint64_t size, size_t map_size) {
+    return offset <= map_size && size <= map_size - offset;
+}
+
+// Maps the metrics.expc sidecar (metrics.<stream>.expc for a namespace stream) if it still
+// describes a prefix of the metrics file behind 'metrics_handle' (same file, not shorter than
+// what the sidecar covers). Returns NULL if the sidecar is missing, corrupt or stale. Rows
+// past 'source_offset' must still be parsed
+MetricsSidecar* Storage_openSidecar(void* metrics_handle) {
+    MetricsHandle* h = (MetricsHandle*)metrics_handle;
+    if (!h) return NULL;
+
+    int fd = open(h->sidecar_path, O_RDONLY);
+    struct stat st, source;
+    bool ok = fd >= 0 && fstat(fd, &st) == 0 && stat(h->path, &source) == 0 &&
+              (size_t)st.st_size >= sizeof(SidecarHeader);
+    if (!ok) {
+        if (fd >= 0) close(fd);
         return NULL;
     }
-    
-    entry->json = json;
-    entry->step = getJsonInt(json, "_step", -1);
-    entry->timestamp = getJsonDouble(json, "_timestamp", 0.0);
 
-    return entry;
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    MetricsSidecar* sc = calloc(1, sizeof(MetricsSidecar));
+    if (!sc) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    sc->map = map;
+    sc->map_size = (size_t)st.st_size;
+
+    const SidecarHeader* hdr = (const SidecarHeader*)map;
+    ok = memcmp(hdr->magic, SIDECAR_MAGIC, 4) == 0 && hdr->version == SIDECAR_VERSION &&
+         hdr->byte_order == SIDECAR_BYTE_ORDER;
+
+    if (ok) {
+        ok = sourceUnchanged(&source, hdr->source_dev, hdr->source_ino, hdr->source_size,
+                             hdr->source_mtime_sec, hdr->source_mtime_nsec);
+    }
+
+    uint64_t dir_size = (uint64_t)hdr->column_count * sizeof(SidecarEntry);
+    if (ok) ok = sidecarRangeValid(sizeof(SidecarHeader), dir_size, sc->map_size);
+    if (ok) {
+        sc->columns = calloc(hdr->column_count ? hdr->column_count : 1, sizeof(SidecarColumn));
+        ok = sc->columns != NULL;
+    }
+
+    const SidecarEntry* entries = (const SidecarEntry*)((const char*)map + sizeof(SidecarHeader));
+    const char* base = (const char*)map;
+    for (uint32_t i = 0; ok && i < hdr->column_count; i++) {
+        const SidecarEntry* e = &entries[i];
+        ok = e->count <= sc->map_size &&
+             sidecarRangeValid(e->name_offset, e->name_len, sc->map_size) &&
+             sidecarRangeValid(e->steps_offset, e->count * sizeof(int64_t), sc->map_size) &&
+             sidecarRangeValid(e->timestamps_offset, e->count * sizeof(double), sc->map_size) &&
+             sidecarRangeValid(e->values_offset, e->count * sizeof(double), sc->map_size) &&
+             (e->steps_offset % 8) == 0 && (e->timestamps_offset % 8) == 0 && (e->values_offset % 8) == 0;
+        if (!ok) break;
+
+        SidecarColumn* c = &sc->columns[i];
+        c->key = base + e->name_offset;
+        c->key_len = (size_t)e->name_len;
+        c->count = (size_t)e->count;
+        c->steps = (const int64_t*)(base + e->steps_offset);
+        c->timestamps = (const double*)(base + e->timestamps_offset);
+        c->values = (const double*)(base + e->values_offset);
+    }
+
+    if (!ok) {
+        Storage_closeSidecar(sc);
+        return NULL;
+    }
+    sc->column_count = (int)hdr->column_count;
+    sc->source_offset = (off_t)hdr->source_size;
+    return sc;
+}
+
+// Unmaps a sidecar; column pointers become invalid
+void Storage_closeSidecar(MetricsSidecar* sidecar) {
+    if (!sidecar) return;
+    if (sidecar->map) munmap(sidecar->map, sidecar->map_size);
+    free(sidecar->columns);
+    free(sidecar);
+}
+
+// Writes the zero padding that follows a 'size'-byte block up to the next 8-byte boundary
+static bool writePadding(FILE* f, uint64_t size) {
+    static const char zeros[8] = {0};
+    uint64_t pad = SIDECAR_ALIGN(size) - size;
+    return pad == 0 || fwrite(zeros, 1, (size_t)pad, f) == pad;
+}
+
+// Writes 'size' bytes followed by zero padding up to the next 8-byte boundary
+static bool writeAligned(FILE* f, const void* data, uint64_t size) {
+    if (size > 0 && fwrite(data, 1, (size_t)size, f) != size) return false;
+    return writePadding(f, size);
+}
+
+// Atomically writes the sidecar of 'metrics_handle' for the columns parsed so far from it.
+// The header records the metrics file's identity, mtime and committed offset
+bool Storage_writeSidecar(void* metrics_handle, const SidecarColumn* columns, int count) {
+    MetricsHandle* h = (MetricsHandle*)metrics_handle;
+    if (!h || !h->file || count < 0) return false;
+
+    struct stat source;
+    if (fstat(fileno(h->file), &source) != 0) return false;
+
+    SidecarHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SIDECAR_MAGIC, 4);
+    hdr.version = SIDECAR_VERSION;
+    hdr.byte_order = SIDECAR_BYTE_ORDER;
+    hdr.column_count = (uint32_t)count;
+    hdr.source_dev = (uint64_t)source.st_dev;
+    hdr.source_ino = (uint64_t)source.st_ino;
+    hdr.source_size = (int64_t)h->committed;
+    hdr.source_mtime_sec = (int64_t)source.st_mtim.tv_sec;
+    hdr.source_mtime_nsec = (int64_t)source.st_mtim.tv_nsec;
+
+    SidecarEntry* entries = calloc(count ? (size_t)count : 1, sizeof(SidecarEntry));
+    if (!entries) return false;
+
+    // Lay out names first, then each key's three columns
+    uint64_t offset = sizeof(SidecarHeader) + (uint64_t)count * sizeof(SidecarEntry);
+    uint64_t names_size = 0;
+    for (int i = 0; i < count; i++) {
+        entries[i].name_offset = offset + names_size;
+        entries[i].name_len = columns[i].key_len;
+        names_size += columns[i].key_len;
+    }
+    offset += SIDECAR_ALIGN(names_size);
+    for (int i = 0; i < count; i++) {
+        uint64_t n = columns[i].count;
+        entries[i].count = n;
+        entries[i].steps_offset = offset;
+        offset += SIDECAR_ALIGN(n * sizeof(int64_t));
+        entries[i].timestamps_offset = offset;
+        offset += SIDECAR_ALIGN(n * sizeof(double));
+        entries[i].values_offset = offset;
+        offset += SIDECAR_ALIGN(n * sizeof(double));
+    }
+
+    size_t tmp_len = strlen(h->sidecar_path) + 5;
+    char* tmp_path = malloc(tmp_len);
+    if (tmp_path) snprintf(tmp_path, tmp_len, "%s.tmp", h->sidecar_path);
+    FILE* f = tmp_path ? fopen(tmp_path, "wb") : NULL;
+    bool ok = f != NULL;
+
+    if (ok) ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    if (ok && count > 0) ok = fwrite(entries, sizeof(SidecarEntry), (size_t)count, f) == (size_t)count;
+    for (int i = 0; ok && i < count; i++) {
+        ok = columns[i].key_len == 0 || fwrite(columns[i].key, 1, columns[i].key_len, f) == columns[i].key_len;
+    }
+    if (ok) ok = writePadding(f, names_size);
+    for (int i = 0; ok && i < count; i++) {
+        uint64_t n = columns[i].count;
+        ok = writeAligned(f, columns[i].steps, n * sizeof(int64_t)) &&
+             writeAligned(f, columns[i].timestamps, n * sizeof(double)) &&
+             writeAligned(f, columns[i].values, n * sizeof(double));
+    }
+
+    if (f && fclose(f) != 0) ok = false;
+    if (ok) ok = rename(tmp_path, h->sidecar_path) == 0;
+    if (!ok && tmp_path) unlink(tmp_path);
+
+    free(entries);
+    free(tmp_path);
+    return ok;
 }
 
 // Closes an open metrics handle and releases associated resources
 void Storage_closeMetrics(void* handle) {
     MetricsHandle* h = (MetricsHandle*)handle;
     if (!h) return;
+    remapMetricsFile(h, 0);
     if (h->file) fclose(h->file);
     if (h->line_buffer) free(h->line_buffer);
+    resetBinaryKeys(h);
+    free(h->key_names);
+    free(h->key_lens);
+    free(h->index);
+    free(h->index_path);
+    free(h->sidecar_path);
+    free(h->path);
     free(h);
 }
 
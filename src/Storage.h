@@ -3,11 +3,18 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <sys/types.h>
+
+#include "MetricsParser.h"
 
 typedef struct cJSON cJSON;
+typedef struct Arena_ Arena;
 
 typedef struct RunConfig_ {
     cJSON* json;
+    Arena* arena;          // Holds every node of 'json'
 } RunConfig;
 
 typedef struct RunMetadata_ {
@@ -29,17 +36,109 @@ typedef struct RunSummary_ {
     char* status;
     double runtime;
     double timestamp;
-    int step;
+    int64_t step;
     int epoch;
     cJSON* json;
+    Arena* arena;          // Holds every node of 'json'
 } RunSummary;
 
+typedef enum MetricsReadMode_ {
+    METRICS_READ_STDIO,   // getline() into a private line buffer
+    METRICS_READ_MMAP,    // Zero-copy slices straight out of a read-only file mapping
+} MetricsReadMode;
+
+// Catches the SIGBUS raised when a read of a metrics mapping lands past the end of a file
+// that shrank underneath it. Guards nest per thread; a fault returns to the innermost one:
+//   MappingGuard guard;
+//   if (sigsetjmp(guard.env, 1)) { ...the read was cut short; the guard is already off... }
+//   Storage_armGuard(&guard);
+//   ...read...
+//   Storage_disarmGuard(&guard);
+typedef struct MappingGuard_ {
+    sigjmp_buf env;
+    struct MappingGuard_* outer;
+} MappingGuard;
+
 typedef struct MetricEntry_ {
-    int step;
+    int64_t step;
     double timestamp;
     cJSON* json;           
 } MetricEntry;
 
+// One key's columns in the metrics.expc sidecar cache. Pointers reference the sidecar
+// mapping when read back, or the caller's series when writing
+typedef struct SidecarColumn_ {
+    const char* key;
+    size_t key_len;
+    size_t count;
+    const int64_t* steps;
+    const double* timestamps;
+    const double* values;
+} SidecarColumn;
+
+// A read-only mapping of metrics.expc: per-key columns covering the first
+// 'source_offset' bytes of the metrics file, in key id order
+typedef struct MetricsSidecar_ {
+    void* map;
+    size_t map_size;
+    off_t source_offset;
+    int column_count;
+    SidecarColumn* columns;
+} MetricsSidecar;
+
+// One key of the writer's keys.json manifest, as of the manifest's covered offset
+typedef struct KeyManifestEntry_ {
+    char* name;
+    int64_t first_step;
+    int64_t last_step;
+    int64_t count;
+    double min_value;      // Range of the finite values; min > max if there were none
+    double max_value;
+    double last_value;     // NaN if the last value logged was not finite
+    off_t first_offset;    // Start of the row the key first appeared in
+} KeyManifestEntry;
+
+// The run's keys.json: every charted key in order of first appearance, with running stats
+// over a prefix of each metrics stream. Lets a reader lay out charts before parsing any
+// rows; it may lag the metrics files a little
+typedef struct KeyManifest_ {
+    KeyManifestEntry* keys;
+    int count;
+    off_t covered_offset;  // Bytes covered, summed over the streams
+} KeyManifest;
+
+// The run's streams.json: the namespaces the writer logs to files of their own
+// (metrics.<name>.jsonl or .expb) rather than to the main metrics file, in creation order
+typedef struct StreamList_ {
+    char** names;
+    int count;
+} StreamList;
+
+// A file's identity and last modification when it was read; any difference (including the
+// file appearing or disappearing) means it has to be read again
+typedef struct FileFingerprint_ {
+    bool present;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_ns;
+} FileFingerprint;
+
+// The run's config.json, metadata.json and summary.json, each parsed once and re-read only
+// when its fingerprint changes. The parsed objects belong to the cache (NULL if missing);
+// a caller may take one by clearing its field, and it is not re-read until its file changes
+typedef struct RunFiles_ {
+    char* run_dir;
+    RunConfig* config;
+    RunMetadata* meta;
+    RunSummary* summary;
+    StreamList* streams;
+    FileFingerprint config_print;
+    FileFingerprint meta_print;
+    FileFingerprint summary_print;
+    FileFingerprint streams_print;
+} RunFiles;
+
 // Finds and returns the path to the most recent run directory in the given expml directory
 char* Storage_findLatestRun(const char* expml_dir);
 
@@ -52,12 +151,116 @@ RunMetadata* Storage_readMetadata(const char* run_dir);
 // Reads and returns the summary information for a specific run
 RunSummary* Storage_readSummary(const char* run_dir);
 
-// Opens the metrics file for sequential reading and returns an opaque handle
-void* Storage_openMetrics(const char* run_dir);
+// Reads the run's keys.json. Returns NULL if it is missing or malformed, or if it does not
+// describe a prefix of each of the run's current metrics streams
+KeyManifest* Storage_readKeyManifest(const char* run_dir);
+
+// Reads the run's streams.json. Names that could not be a stream are left out. Returns NULL
+// if it is missing or malformed; a run without one logs everything to the main file
+StreamList* Storage_readStreamList(const char* run_dir);
+
+// Returns true if two fingerprints describe the same version of a file
+bool Storage_sameFingerprint(const FileFingerprint* a, const FileFingerprint* b);
+
+// Creates an empty cache of the run's JSON files; nothing is read until the first refresh
+RunFiles* Storage_openRunFiles(const char* run_dir);
+
+// Re-reads whichever of config.json, metadata.json, summary.json and streams.json changed on
+// disk since the last call. Returns true if any cached object was replaced
+bool Storage_refreshRunFiles(RunFiles* files);
+
+// Frees the cache and every object it holds
+void Storage_closeRunFiles(RunFiles* files);
+
+// Starts watching the run directory for changes to the files the TUI reads. Returns a
+// non-blocking descriptor to poll, or -1 if change notification is unavailable here
+int Storage_watchRun(const char* run_dir);
+
+// Consumes every pending notification on a descriptor from Storage_watchRun. Returns true if
+// any concerns a run file; the TUI's own log, sidecar and index writes are ignored
+bool Storage_drainRunWatch(int fd);
+
+// Stops watching and closes the descriptor
+void Storage_unwatchRun(int fd);
+
+// Opens the metrics file for incremental reading and returns an opaque handle. Reads the
+// binary metrics.expb if the run has one, else metrics.jsonl.
+// METRICS_READ_MMAP falls back to stdio if the file cannot be mapped
+void* Storage_openMetrics(const char* run_dir, MetricsReadMode mode);
 
-// Reads the next metric entry from an open metrics handle, or NULL if no more entries
+// Like Storage_openMetrics, for the namespace stream 'stream' (metrics.<stream>.expb or
+// .jsonl). The handle's step index and sidecar are the stream's own. NULL opens the main file
+void* Storage_openMetricsStream(const char* run_dir, const char* stream, MetricsReadMode mode);
+
+// Re-checks the metrics file behind an open handle. Returns true if the file was truncated
+// or replaced, in which case reading restarts at byte 0 and all previous entries are stale
+bool Storage_syncMetrics(void* handle);
+
+// Drops everything read from a metrics handle and reopens its file from byte 0, as a sync
+// that found it replaced does. Used after a guarded read faulted
+void Storage_reopenMetrics(void* handle);
+
+// Makes 'guard' the calling thread's innermost mapping guard; see MappingGuard
+void Storage_armGuard(MappingGuard* guard);
+
+// Takes 'guard', the calling thread's innermost mapping guard, off again
+void Storage_disarmGuard(MappingGuard* guard);
+
+// Returns the byte offset just past the last complete line or record read from the handle
+off_t Storage_getMetricsOffset(void* handle);
+
+// Hands out the next complete line (without its newline) as a slice into the handle's buffer
+// or mapping. The slice stays valid until the next read or sync on the same handle.
+// JSONL only; binary handles have no lines
+bool Storage_readNextLine(void* handle, const char** line, size_t* len);
+
+// Returns every complete line not read yet as one slice of the mapping, without consuming
+// them; seek past the slice once it has been parsed. Only JSONL handles in
+// METRICS_READ_MMAP mode support this. The slice stays valid until the next sync, and is
+// read under a MappingGuard since the file may still shrink underneath it
+bool Storage_peekMetrics(void* handle, const char** data, size_t* len);
+
+// Parses the next complete metrics line into a reusable record without building a cJSON
+// tree for flat rows. Malformed lines are skipped. Returns false when no more lines are ready.
+// For binary handles, decodes the next row record instead
+bool Storage_readNextRecord(void* handle, MetricRecord* record);
+
+// Reads the next complete metric entry from an open metrics handle, or NULL if no more entries.
+// A partially written trailing line is left unread until the writer finishes it
 MetricEntry* Storage_readNextMetric(void* handle);
 
+// Moves the read position of a metrics handle to a line boundary previously reported by
+// Storage_getMetricsOffset (e.g. the end of what a sidecar cache already covers).
+// A binary handle that fails to seek is left back at the start of the file
+bool Storage_seekMetrics(void* handle, off_t offset);
+
+// Extends the sparse _step index over every line consumed from the handle so far, as long
+// as the index already reaches 'from', where the caller's reads began: the index runs
+// unbroken from byte 0, and lines nobody read are not paged in just to index them.
+// Only JSONL handles in METRICS_READ_MMAP mode are indexed
+void Storage_updateStepIndex(void* handle, off_t from);
+
+// Returns an offset to read from to see every row whose _step is at least 'step': all rows
+// before it have lower steps. Without an index this is 0, the start of the file
+off_t Storage_findStep(void* handle, int64_t step);
+
+// Atomically writes metrics.sidx for everything indexed so far. Does nothing if the index
+// on disk is already current. Returns true if written
+bool Storage_saveStepIndex(void* handle);
+
+// Maps the metrics.expc sidecar (metrics.<stream>.expc for a namespace stream) if it still
+// describes a prefix of the metrics file behind 'metrics_handle' (same file, not shorter than
+// what the sidecar covers). Returns NULL if the sidecar is missing, corrupt or stale. Rows
+// past 'source_offset' must still be parsed
+MetricsSidecar* Storage_openSidecar(void* metrics_handle);
+
+// Unmaps a sidecar; column pointers become invalid
+void Storage_closeSidecar(MetricsSidecar* sidecar);
+
+// Atomically writes the sidecar of 'metrics_handle' for the columns parsed so far from it.
+// The header records the metrics file's identity, mtime and committed offset
+bool Storage_writeSidecar(void* metrics_handle, const SidecarColumn* columns, int count);
+
 // Closes an open metrics handle and releases associated resources
 void Storage_closeMetrics(void* handle);
 
@@ -70,6 +273,12 @@ void Storage_freeRunMetadata(RunMetadata* meta);
 // Frees memory allocated for a RunSummary structure
 void Storage_freeRunSummary(RunSummary* summary);
 
+// Frees memory allocated for a KeyManifest structure
+void Storage_freeKeyManifest(KeyManifest* manifest);
+
+// Frees memory allocated for a StreamList structure
+void Storage_freeStreamList(StreamList* streams);
+
 // Frees memory allocated for a MetricEntry structure
 void Storage_freeMetricEntry(MetricEntry* entry);
 
@@ -5,6 +5,7 @@
 #include "Panel.h"
 #include "Storage.h"
 #include "Terminal.h"
+#include "Arena.h"
 #include "Constants.h"
 #include "RunPanel.h"
 #include "DataLoader.h"
@@ -21,61 +22,167 @@
 
 typedef struct {
     char* run_path;
+    DataLoader* loader;
+    RunConfig* config;     // Latest run files handed over by the loader; NULL if missing
+    RunMetadata* meta;
+    RunSummary* summary;
+    int load_percent;      // Progress of a newest-first history load; 100 once complete
+    size_t max_memory;     // Memory budget for the metrics; 0 for none
+    size_t memory_used;    // What the metrics took up at the last snapshot, under a budget
+    double downsample_ratio;
     Panel* runPanel;
     Panel* metricsPanel;
     Panel* systemPanel;
     FunctionBar* funcBar;
     ScreenManager* sm;
+    int watch_fd;          // Run file change notification, closed once the run has ended
 } AppContext;
 
-// Refresh callback - reloads data from storage
+// Writes a byte count the way --max-memory takes it (e.g. 312M)
+static void formatBytes(char* buf, size_t size, size_t bytes) {
+   const char* units = "BKMGT";
+   double value = (double)bytes;
+   int unit = 0;
+   while (value >= 1024 && unit < 4) {
+       value /= 1024;
+       unit++;
+   }
+   snprintf(buf, size, value < 10 && unit > 0 ? "%.1f%c" : "%.0f%c", value, units[unit]);
+}
+
+// Shows the run's state in the function bar, plus history load progress while it lasts and
+// the metrics' memory use (and how far they are downsampled) under a budget
+static void updateContext(AppContext* ctx) {
+   char progress[96] = "";
+   int len = 0;
+   if (ctx->load_percent < 100) {
+       len = snprintf(progress, sizeof(progress), " | Loading history %d%%", ctx->load_percent);
+   }
+   if (ctx->max_memory > 0) {
+       char used[16], budget[16];
+       formatBytes(used, sizeof(used), ctx->memory_used);
+       formatBytes(budget, sizeof(budget), ctx->max_memory);
+       len += snprintf(progress + len, sizeof(progress) - len, " | Mem %s/%s", used, budget);
+       if (ctx->downsample_ratio > 1.005) {
+           snprintf(progress + len, sizeof(progress) - len, " %.1f:1", ctx->downsample_ratio);
+       }
+   }
+
+   RunSummary* summary = ctx->summary;
+   if (!summary) {
+       FunctionBar_setContext(ctx->funcBar, "%s", progress[0] ? progress + 2 : "");
+       return;
+   }
+
+   const char* r_name = (ctx->meta && ctx->meta->run_name) ? ctx->meta->run_name : "Unknown";
+   const char* status = summary->status ? summary->status : "UNKNOWN";
+
+   FunctionBar_setContext(ctx->funcBar, 
+       " Run: %s | State: %s | Runtime: %.0fs | Step: %lld%s", 
+       r_name,
+       status, 
+       summary->runtime, 
+       (long long)summary->step,
+       progress
+   );
+}
+
+// Refresh callback - shows the latest snapshot the loader thread published. All parsing
+// happened on that thread; this only swaps panel contents
 static void on_refresh(void* userdata) {
    AppContext* ctx = (AppContext*)userdata;
+   DataSnapshot* snap = DataLoader_takeSnapshot(ctx->loader);
+   if (!snap) return;
+
+   if (snap->metrics_changed) {
+       int saved_metrics_selection = Panel_getSelectedIndex(ctx->metricsPanel);
+       DataSnapshot_populate(snap, ctx->metricsPanel, ctx->systemPanel);
+       Panel_setSelected(ctx->metricsPanel, saved_metrics_selection);
+
+       if (snap->load_percent != ctx->load_percent || snap->memory_used != ctx->memory_used ||
+           snap->downsample_ratio != ctx->downsample_ratio) {
+           ctx->load_percent = snap->load_percent;
+           ctx->memory_used = snap->memory_used;
+           ctx->downsample_ratio = snap->downsample_ratio;
+           updateContext(ctx);
+       }
+   }
 
-   int saved_metrics_selection = Panel_getSelectedIndex(ctx->metricsPanel);
-   DataLoader_loadMetrics(ctx->run_path, ctx->metricsPanel, ctx->systemPanel);
-   Panel_setSelected(ctx->metricsPanel, saved_metrics_selection);
+   // Nothing below depends on anything but the run files, so skip it while they are unchanged
+   if (snap->files_changed == 0) {
+       DataSnapshot_delete(snap);
+       return;
+   }
+
+   // Adopt the run files that changed; the snapshot then no longer owns them
+   if (snap->files_changed & SNAPSHOT_CONFIG) {
+       Storage_freeRunConfig(ctx->config);
+       ctx->config = snap->config;
+       snap->config = NULL;
+   }
+   if (snap->files_changed & SNAPSHOT_METADATA) {
+       Storage_freeRunMetadata(ctx->meta);
+       ctx->meta = snap->meta;
+       snap->meta = NULL;
+   }
+   if (snap->files_changed & SNAPSHOT_SUMMARY) {
+       Storage_freeRunSummary(ctx->summary);
+       ctx->summary = snap->summary;
+       snap->summary = NULL;
+   }
+   DataSnapshot_delete(snap);
 
-   RunSummary* summary = Storage_readSummary(ctx->run_path);
-   RunConfig* config = Storage_readConfig(ctx->run_path);
-   RunMetadata* meta = Storage_readMetadata(ctx->run_path);
+   RunSummary* summary = ctx->summary;
+   RunConfig* config = ctx->config;
+   RunMetadata* meta = ctx->meta;
 
    if (summary || config || meta) { RunPanel_setData(ctx->runPanel, config, meta, summary); }
    
+   updateContext(ctx);
+   
    if (summary) {
         ScreenManager_setHeaderStatus(ctx->sm, summary->status);
         ScreenManager_setHeaderRuntime(ctx->sm, summary->runtime);
 
-        const char* r_name = (meta && meta->run_name) ? meta->run_name : "Unknown";
         const char* status = summary->status ? summary->status : "UNKNOWN";
 
-        FunctionBar_setContext(ctx->funcBar, 
-            " Run: %s | State: %s | Runtime: %.0fs | Step: %d", 
-            r_name,
-            status, 
-            summary->runtime, 
-            summary->step
-        );
-
-        // If the experiment is done, there is no need to reload files every second.
-        // This saves CPU and prevents selection glitches.
-        if (strcmp(status, "FINISHED") == 0 || 
-            strcmp(status, "FAILED") == 0 || 
-            strcmp(status, "CRASHED") == 0 || 
-            strcmp(status, "STOPPED") == 0) {
-            
-            // Passing NULL disables the timer in ScreenManager
-            ScreenManager_setRefreshCallback(ctx->sm, NULL, NULL);
+        // If the experiment is done, its files will not change again: stop watching them
+        // (the loader thread stops polling on its own, and caches the parsed columns for
+        // the next open). This callback stays, since the history load and cards scrolling
+        // into view still publish snapshots
+        if ((strcmp(status, "FINISHED") == 0 || 
+             strcmp(status, "FAILED") == 0 || 
+             strcmp(status, "CRASHED") == 0 || 
+             strcmp(status, "STOPPED") == 0) && ctx->watch_fd >= 0) {
+            ScreenManager_removeWatch(ctx->sm, ctx->watch_fd);
+            Storage_unwatchRun(ctx->watch_fd);
+            ctx->watch_fd = -1;
         }
    }
-   
-   Storage_freeRunSummary(summary);
-   Storage_freeRunConfig(config);
-   Storage_freeRunMetadata(meta);
+}
+
+// Visible callback - lets the loader keep full history only for the cards on screen
+static void on_visible_keys(const int* key_ids, int count, void* userdata) {
+   AppContext* ctx = (AppContext*)userdata;
+   DataLoader_setProjection(ctx->loader, key_ids, count);
+}
+
+// Watch callback - wakes the loader thread when a run file we display changed
+static bool on_run_changed(int fd, void* userdata) {
+   AppContext* ctx = (AppContext*)userdata;
+   if (Storage_drainRunWatch(fd)) DataLoader_request(ctx->loader);
+   return false;
+}
+
+// Watch callback - schedules a refresh once the loader thread has published a snapshot
+static bool on_snapshot(int fd, void* userdata) {
+   (void)fd;
+   AppContext* ctx = (AppContext*)userdata;
+   return DataLoader_drainNotify(ctx->loader);
 }
 
 // Main TUI entry point
-void runTUI(const char* expml_dir) {
+void runTUI(const char* expml_dir, int64_t window, size_t max_memory) {
    char* run_path = Storage_findLatestRun(expml_dir);
    if (!run_path) {
        fprintf(stderr, "ERROR: Could not resolve 'latest-run' in '%s'\n", expml_dir);
@@ -135,6 +242,14 @@ void runTUI(const char* expml_dir) {
 
    AppContext ctx;
    ctx.run_path = run_path;
+   ctx.loader = DataLoader_new(run_path);
+   ctx.config = NULL;
+   ctx.meta = NULL;
+   ctx.summary = NULL;
+   ctx.load_percent = 100;
+   ctx.max_memory = max_memory;
+   ctx.memory_used = 0;
+   ctx.downsample_ratio = 1.0;
    ctx.runPanel = runPanel;
    ctx.metricsPanel = metricsPanel;
    ctx.systemPanel = systemPanel;
@@ -143,16 +258,52 @@ void runTUI(const char* expml_dir) {
 
    // 5. Start Loop
    ScreenManager_setRefreshCallback(sm, on_refresh, &ctx);
+   MetricsPanel_setVisibleCallback(metricsPanel, on_visible_keys, &ctx);
+
+   // Reload when the run's files change rather than on a timer (polling remains the fallback)
+   int watch_fd = Storage_watchRun(run_path);
+   ctx.watch_fd = watch_fd;
+   if (watch_fd >= 0) {
+       ScreenManager_addWatch(sm, watch_fd, on_run_changed, &ctx);
+   } else {
+       LOG_INFO("File change notification unavailable, polling every second");
+   }
+
+   // Parsing runs on the loader thread; the screen picks up each snapshot it publishes
+   if (window > 0) {
+       DataLoader_setWindow(ctx.loader, window);
+       LOG_INFO("Keeping the last %lld steps of each metric", (long long)window);
+   }
+   if (max_memory > 0) {
+       DataLoader_setMemoryBudget(ctx.loader, max_memory);
+       LOG_INFO("Keeping metrics within %zu bytes", max_memory);
+   }
+   if (ctx.loader && DataLoader_start(ctx.loader, watch_fd >= 0 ? 0.0 : 1.0)) {
+       ScreenManager_addWatch(sm, DataLoader_getNotifyFd(ctx.loader), on_snapshot, &ctx);
+   } else {
+       LOG_ERROR("Could not start loading metrics for %s", run_path);
+   }
    
-   // Trigger one refresh before loop to populate data immediately
-   on_refresh(&ctx);
+   // Start the first load right away
+   DataLoader_request(ctx.loader);
    
    ScreenManager_run(sm);
 
    // 6. Cleanup
    ScreenManager_delete(sm);
+   Storage_unwatchRun(ctx.watch_fd);
+   DataLoader_stop(ctx.loader);
+   DataLoader_saveCache(ctx.loader);
+   DataLoader_delete(ctx.loader);
+   Storage_freeRunConfig(ctx.config);
+   Storage_freeRunMetadata(ctx.meta);
+   Storage_freeRunSummary(ctx.summary);
    Terminal_done(); // Restore terminal
    
+   ArenaStats arenas = Arena_getTotals();
+   LOG_INFO("Arenas served %llu allocations (%llu bytes) from %llu heap blocks",
+            (unsigned long long)arenas.allocations, (unsigned long long)arenas.bytes,
+            (unsigned long long)arenas.blocks);
    LOG_INFO("TUI Session Ended");
    Log_close(); // Close log file
    
@@ -1,6 +1,13 @@
 #ifndef TUI_H
 #define TUI_H
 
-void runTUI(const char* expml_dir);
+#include <stdint.h>
+
+#include <stddef.h>
+
+// Runs the TUI on the latest run under 'expml_dir'. A positive 'window' keeps only that
+// many of the newest steps of each metric; a positive 'max_memory' caps the bytes all
+// metrics take up, downsampling their oldest points to stay within it
+void runTUI(const char* expml_dir, int64_t window, size_t max_memory);
 
 #endif
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "CommandLine.h"
+#include "Arena.h"
 
 int main(int argc, char** argv) {
+    // Before any loader thread can parse JSON
+    Arena_installJsonHooks();
     return CommandLine_run(argc, argv);
 }